@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <vector>
+
+#include "arghandler.h"
+#include "memoryresource.h"
+#include "benchmark.h"
+
+// =================================================================================================
+// ArgHandler: loading an ini file, parsing single arguments and looking values up
+
+void BenchArgHandler(void) {
+    const int argCount = 2000;
+    std::string fileName = Benchmark::TempFile("apptools_bench.ini");
+    FILE* f = fopen(fileName.c_str(), "w");
+    if (not f) {
+        fprintf(stderr, "  can't create '%s'\n", fileName.c_str());
+        return;
+    }
+    std::vector<String> args;
+    std::vector<std::string> keys;
+    char line[128];
+    for (int i = 0; i < argCount; i++) {
+        if (i % 10 == 0)
+            fprintf(f, "# comment %d\n", i);
+        snprintf(line, sizeof(line), "key%d=%d,%d:%d;%d:%d", i, i, i + 1, i + 2, i + 3, i + 4);
+        fprintf(f, "%s\n", line);
+        args.push_back(String(line));
+        keys.push_back("key" + std::to_string(i));
+    }
+    fclose(f);
+
+    Benchmark::Measure("LoadArgs (per line)", argCount, [&]() {
+        ArgHandler handler;
+        Benchmark::Keep(uint64_t(handler.LoadArgs(fileName.c_str())));
+    });
+    ArenaResource arena("bench arghandler");
+    Benchmark::Measure("LoadArgs into an arena (per line)", argCount, [&]() {
+        ArgHandler handler;
+        Benchmark::Keep(uint64_t(handler.LoadArgs(fileName.c_str(), &arena)));
+        arena.Release();
+    });
+    Benchmark::Measure("Add (per argument)", argCount, [&]() {
+        ArgHandler handler;
+        for (const auto& a : args)
+            handler.Add(a);
+    });
+
+    ArgHandler handler;
+    handler.LoadArgs(fileName.c_str());
+    const int lookups = 100000;
+    Benchmark::Measure("GetArg", lookups, [&]() {
+        uint64_t found = 0;
+        for (int i = 0; i < lookups; i++)
+            found += (handler.GetArg(keys[(i * 7919) % argCount].c_str()) != nullptr);
+        Benchmark::Keep(found);
+    });
+    Benchmark::Measure("IntVal (nested value)", lookups, [&]() {
+        uint64_t sum = 0;
+        for (int i = 0; i < lookups; i++)
+            sum += uint64_t(handler.IntVal(keys[(i * 7919) % argCount].c_str(), 1));
+        Benchmark::Keep(sum);
+    });
+    remove(fileName.c_str());
+}
+
+// =================================================================================================
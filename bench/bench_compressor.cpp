@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "networkcapture.h"
+#include "payloadcompressor.h"
+#include "benchmark.h"
+
+// =================================================================================================
+// PayloadCompressor on captured traffic: a CaptureRecorder file of game-like datagrams (position
+// updates, state and event messages, one to four per datagram as MessageCoalescer packs them) is
+// replayed with CaptureReplay and every datagram compressed and expanded again, with and without a
+// dictionary trained on the first datagrams. Reports MB/s of payload data and the compression ratio
+// (datagrams that don't get smaller count with their own size, as they are sent uncompressed).
+
+static std::vector<std::string> ReplayCapture(void) {
+    std::string fileName = Benchmark::TempFile("apptools_bench_compressor.cap");
+    {
+        CaptureRecorder recorder;
+        if (not recorder.Open(fileName.c_str()))
+            return {};
+        UDPAddress address;
+        address.ParseHost("127.0.0.1");
+        address.SetPort(9100);
+        uint32_t random = 0x9E3779B9;
+        auto next = [&random](uint32_t range) {
+            random = random * 1664525u + 1013904223u;
+            return (random >> 8) % range;
+        };
+        char message[256];
+        for (int i = 0; i < 20000; i++) {
+            std::string datagram;
+            for (uint32_t j = 0, n = 1 + next(4); j < n; j++) {
+                uint32_t id = next(64);
+                switch (next(4)) {
+                    case 0:
+                    case 1:
+                        snprintf(message, sizeof(message), "move#%u;%.2f;%.2f;%.2f;%.3f;%u", id,
+                                 float(next(20000)) * 0.01f, float(next(2000)) * 0.01f, float(next(20000)) * 0.01f, float(next(6283)) * 0.001f, next(2));
+                        break;
+                    case 2:
+                        snprintf(message, sizeof(message), "state#%u;%u;%u;%u;idle;%u;%u;%u", id, next(100), next(100), next(10), next(3), next(1000), next(2));
+                        break;
+                    default:
+                        snprintf(message, sizeof(message), "event#%u;%s;%u;%u", id, (next(2) ? "hit" : "pickup"), next(64), next(500));
+                }
+                if (not datagram.empty())
+                    datagram += '\n';
+                datagram += message;
+            }
+            recorder.Record(false, address, nullptr, 0, datagram.data(), datagram.length());
+        }
+    }
+    std::vector<std::string> payloads;
+    CaptureReplay replay;
+    ReplayParams params;
+    params.speed = 0.0f;
+    if (replay.Open(fileName.c_str(), params)) {
+        UDPDatagram datagram;
+        while (replay.Next(datagram))
+            payloads.emplace_back(datagram.Data(), datagram.m_length);
+    }
+    replay.Close();
+    remove(fileName.c_str());
+    return payloads;
+}
+
+
+static void MeasureCompressor(const char* name, PayloadCompressor& compressor, const std::vector<std::string>& payloads, size_t bytes) {
+    const size_t count = payloads.size();
+    std::vector<std::vector<uint8_t>> compressed(count, std::vector<uint8_t>(UDP_MAX_DATAGRAM_SIZE));
+    std::vector<size_t> lengths(count);
+    char caseName[96];
+    snprintf(caseName, sizeof(caseName), "Compress, %s (per datagram)", name);
+    double ns = Benchmark::Measure(caseName, count, [&]() {
+        for (size_t i = 0; i < count; i++)
+            lengths[i] = compressor.Compress(reinterpret_cast<const uint8_t*>(payloads[i].data()), payloads[i].length(), compressed[i].data(), compressed[i].size());
+    });
+    size_t compressedBytes = 0;
+    for (size_t i = 0; i < count; i++)
+        compressedBytes += lengths[i] ? lengths[i] : payloads[i].length();
+    printf("  %-52s %12.1f MB/s %9.3f ratio\n", "", double(bytes) * 1e3 / (ns * double(count)), double(compressedBytes) / double(bytes));
+
+    uint8_t output[UDP_MAX_DATAGRAM_SIZE];
+    uint64_t failures = 0;
+    snprintf(caseName, sizeof(caseName), "Expand, %s (per datagram)", name);
+    ns = Benchmark::Measure(caseName, count, [&]() {
+        for (size_t i = 0; i < count; i++)
+            if (lengths[i])
+                failures += (compressor.Expand(compressed[i].data(), lengths[i], output, sizeof(output)) != int(payloads[i].length()));
+    });
+    printf("  %-52s %12.1f MB/s\n", "", double(bytes) * 1e3 / (ns * double(count)));
+    if (failures)
+        printf("  %llu datagrams didn't expand to their original size\n", (unsigned long long) failures);
+}
+
+
+void BenchCompressor(void) {
+    std::vector<std::string> payloads = ReplayCapture();
+    if (payloads.empty()) {
+        fprintf(stderr, "  can't record or replay the capture file\n");
+        return;
+    }
+    size_t bytes = 0;
+    for (const auto& p : payloads)
+        bytes += p.length();
+    printf("  %zu datagrams, %.1f bytes on average\n", payloads.size(), double(bytes) / double(payloads.size()));
+
+    PayloadCompressor plain;
+    MeasureCompressor("no dictionary", plain, payloads, bytes);
+    PayloadCompressor trained;
+    trained.Train(std::vector<std::string>(payloads.begin(), payloads.begin() + std::min(payloads.size(), size_t(256))));
+    MeasureCompressor("trained dictionary", trained, payloads, bytes);
+}
+
+// =================================================================================================
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "deltacodec.h"
+#include "benchmark.h"
+
+// =================================================================================================
+// DeltaCodec bandwidth: a server sends the state of 32 entities to 64 peers every tick over UDP
+// loopback; every peer decodes them and acknowledges once per tick, as a game would. Reports payload
+// bytes per peer and tick for full retransmission (what the messages are before encoding) and delta
+// coded, once with a quarter of the entities moving each tick and once with all of them moving.
+
+static const uint16_t serverPort = 47400;
+static const uint16_t peerInPort = 47410;   // 64 ports from here
+static const uint16_t peerOutPort = 47480;  // and from here
+
+
+static void MeasureBandwidth(const char* name, int peerCount, int entityCount, int movingShare, int ticks) {
+    UDP server;
+    server.m_localAddress = String("0.0.0.0");
+    if (not (server.OpenSocket(serverPort, 0) and server.OpenSocket(uint16_t(serverPort + 1), 1))) {
+        fprintf(stderr, "  can't open UDP ports %u and %u\n", unsigned(serverPort), unsigned(serverPort + 1));
+        return;
+    }
+    DeltaCodec encoder(server);
+    encoder.Register("pos");
+    std::vector<std::unique_ptr<UDP>> peers;
+    std::vector<std::unique_ptr<DeltaCodec>> decoders;
+    std::vector<UDPPeer> targets;
+    for (int i = 0; i < peerCount; i++) {
+        peers.emplace_back(new UDP);
+        UDP& udp = *peers.back();
+        udp.m_localAddress = String("0.0.0.0");
+        if (not (udp.OpenSocket(uint16_t(peerInPort + i), 0) and udp.OpenSocket(uint16_t(peerOutPort + i), 1))) {
+            fprintf(stderr, "  can't open UDP ports %u and %u\n", unsigned(peerInPort + i), unsigned(peerOutPort + i));
+            return;
+        }
+        decoders.emplace_back(new DeltaCodec(udp));
+        decoders.back()->Register("pos");
+        targets.emplace_back(String("127.0.0.1"), uint16_t(peerInPort + i));
+    }
+
+    // entity state (after the id): x; y; z; heading; animation; health. Moving entities change x, z and heading.
+    std::vector<std::vector<int>> entities(entityCount);
+    for (int e = 0; e < entityCount; e++)
+        entities[e] = { 1000 + 37 * e, 0, 2000 - 53 * e, 90 * (e % 4), e % 3, 100 };
+    uint64_t decoded = 0, sent = 0;
+    char message[128];
+    Message m;
+    for (int tick = 0; tick < ticks; tick++) {
+        for (int e = 0; e < entityCount; e++) {
+            std::vector<int>& s = entities[e];
+            if ((movingShare == 1) or (e % movingShare == tick % movingShare)) {
+                s[0] += 7 + e % 5;
+                s[2] -= 3 + e % 7;
+                s[3] = (s[3] + 5) % 360;
+            }
+        }
+        for (int p = 0; p < peerCount; p++)
+            for (int e = 0; e < entityCount; e++) {
+                const std::vector<int>& s = entities[e];
+                snprintf(message, sizeof(message), "pos#%d;%.2f;%.2f;%.2f;%.1f;%d;%d", e, float(s[0]) * 0.01f, float(s[1]) * 0.01f,
+                         float(s[2]) * 0.01f, float(s[3]), s[4], s[5]);
+                sent += encoder.Transmit(targets[p], String(message));
+            }
+        for (int p = 0; p < peerCount; p++) {
+            while (decoders[p]->Receive(m))
+                ++decoded;
+            decoders[p]->Flush();
+        }
+        while (encoder.Receive(m))    // acks; consumed by the codec
+            ;
+    }
+
+    uint64_t rawBytes = 0, encodedBytes = 0, undecodable = 0;
+    for (const auto& [key, peer] : encoder.m_peers) {
+        rawBytes += peer.m_rawBytes;
+        encodedBytes += peer.m_encodedBytes;
+    }
+    for (const auto& decoder : decoders)
+        undecodable += decoder->m_undecodable;
+    double perPeerTick = double(peerCount) * double(ticks);
+    printf("  %-52s %9.0f B full %9.0f B delta %7.3f ratio\n", name, double(rawBytes) / perPeerTick, double(encodedBytes) / perPeerTick,
+           rawBytes ? double(encodedBytes) / double(rawBytes) : 1.0);
+    printf("  %-52s %9llu sent %9llu decoded %7llu undecodable, %llu full states\n", "", (unsigned long long) sent, (unsigned long long) decoded,
+           (unsigned long long) undecodable, (unsigned long long) encoder.m_fullStates);
+    fflush(stdout);
+}
+
+
+void BenchDeltaCodec(void) {
+    MeasureBandwidth("64 peers, 32 entities, 1/4 moving (per peer and tick)", 64, 32, 4, 100);
+    MeasureBandwidth("64 peers, 32 entities, all moving (per peer and tick)", 64, 32, 1, 100);
+}
+
+// =================================================================================================
@@ -0,0 +1,99 @@
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "jobsystem.h"
+#include "benchmark.h"
+
+// =================================================================================================
+// JobSystem: cost per task (empty jobs, so only the queueing and stealing remains) and scaling of
+// a compute bound ParallelFor over 1 .. hardware threads (the caller plus threads - 1 workers)
+
+static void MeasureOverhead(void) {
+    JobSystem jobs;
+    const int count = 100000;
+    Benchmark::Measure("Run + Wait, empty jobs (per job)", count, [&]() {
+        JobSystem::TaskGroup group;
+        for (int i = 0; i < count; i++)
+            jobs.Run(group, []() { });
+        jobs.Wait(group);
+    });
+    Benchmark::Measure("Run + Wait, one job at a time", count / 10, [&]() {
+        for (int i = 0; i < count / 10; i++) {
+            JobSystem::TaskGroup group;
+            jobs.Run(group, []() { });
+            jobs.Wait(group);
+        }
+    });
+    Benchmark::Measure("Async + get", count / 10, [&]() {
+        uint64_t sum = 0;
+        for (int i = 0; i < count / 10; i++)
+            sum += uint64_t(jobs.Async([i]() { return i; }).get());
+        Benchmark::Keep(sum);
+    });
+    Benchmark::Measure("nested Run from jobs (per job)", count, [&]() {
+        JobSystem::TaskGroup outer;
+        for (int i = 0; i < 100; i++)
+            jobs.Run(outer, [&jobs, count]() {
+                JobSystem::TaskGroup inner;
+                for (int j = 0; j < count / 100; j++)
+                    jobs.Run(inner, []() { });
+                jobs.Wait(inner);
+            });
+        jobs.Wait(outer);
+    });
+    Benchmark::Measure("ParallelFor, grain 1 (per index)", count, [&]() {
+        std::vector<uint32_t> out(count);
+        jobs.ParallelFor(0, out.size(), 1, [&out](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++)
+                out[i] = uint32_t(i);
+        });
+        Benchmark::Keep(out[count - 1]);
+    });
+    printf("  %d workers, %llu jobs executed, %llu stolen\n", jobs.WorkerCount(),
+           (unsigned long long) jobs.m_executed.load(), (unsigned long long) jobs.m_stolen.load());
+}
+
+
+static void MeasureScaling(void) {
+    const size_t count = 1 << 22;
+    const size_t grain = 1 << 14;
+    std::vector<float> data(count);
+    for (size_t i = 0; i < count; i++)
+        data[i] = float(i % 1000) * 0.01f;
+    auto body = [&data](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            float x = data[i];
+            for (int k = 0; k < 16; k++)
+                x = sqrtf(x * x + 1.0f) * 0.999f;
+            data[i] = x;
+        }
+    };
+
+    int hardwareThreads = std::max(int(std::thread::hardware_concurrency()), 1);
+    printf("  %d hardware threads\n", hardwareThreads);
+    double single = 0.0;
+    char name[64];
+    for (int threads = 1; threads <= std::max(hardwareThreads, 8); threads *= 2) {
+        double ns;
+        snprintf(name, sizeof(name), "ParallelFor, %d thread%s (per element)", threads, (threads > 1) ? "s" : "");
+        if (threads == 1) {
+            ns = single = Benchmark::Measure(name, count, [&]() { body(0, count); });
+        }
+        else {
+            JobSystem jobs(threads - 1);
+            ns = Benchmark::Measure(name, count, [&]() { jobs.ParallelFor(0, count, grain, body); });
+        }
+        printf("  %-52s %12.2fx%s\n", "  speedup", single / ns, (threads > hardwareThreads) ? " (more threads than hardware threads)" : "");
+    }
+}
+
+
+void BenchJobSystem(void) {
+    MeasureOverhead();
+    MeasureScaling();
+}
+
+// =================================================================================================
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <string>
+
+#include "networkmessage.h"
+#include "benchmark.h"
+
+// =================================================================================================
+// Message::IsValid parsing: String based messages and pooled ones (MessageArena)
+
+void BenchMessage(void) {
+    const int count = 200000;
+    std::string shortPayload = "move#17;12.5;-3.25;0.5;1;0";
+    std::string longPayload = "state#";
+    for (int i = 0; i < 32; i++)
+        longPayload += std::to_string(i * 37) + ((i < 31) ? ";" : "");
+
+    // the payload is split once per message, so every round assigns it again
+    auto measure = [count](const char* name, Message& message, const std::string& payload, int valueCount) {
+        Benchmark::Measure(name, count, [&]() {
+            uint64_t n = 0;
+            for (int i = 0; i < count; i++) {
+                message.Assign(payload.data(), payload.length(), "127.0.0.1", 9100);
+                n += message.IsValid(valueCount);
+            }
+            Benchmark::Keep(n);
+        });
+    };
+    Message message;
+    measure("Assign + IsValid, 6 values", message, shortPayload, 6);
+    measure("Assign + IsValid, 32 values", message, longPayload, 32);
+    MessageArena arena;
+    Message pooled(&arena);
+    measure("Assign + IsValid, 6 values, pooled", pooled, shortPayload, 6);
+    measure("Assign + IsValid, 32 values, pooled", pooled, longPayload, 32);
+
+    // split on the I/O thread (NetworkThread's preParse): the game thread only checks the count
+    pooled.Assign(longPayload.data(), longPayload.length(), "127.0.0.1", 9100);
+    pooled.Split();
+    Benchmark::Measure("IsValid after Split, 32 values, pooled", count, [&]() {
+        uint64_t n = 0;
+        for (int i = 0; i < count; i++)
+            n += pooled.IsValid(32);
+        Benchmark::Keep(n);
+    });
+    Benchmark::Measure("Assign + IsValid + ToInt, pooled", count, [&]() {
+        uint64_t n = 0;
+        for (int i = 0; i < count; i++) {
+            pooled.Assign(shortPayload.data(), shortPayload.length(), "127.0.0.1", 9100);
+            if (pooled.IsValid(6))
+                n += uint64_t(pooled.ToInt(0));
+        }
+        Benchmark::Keep(n);
+    });
+}
+
+// =================================================================================================
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "messagedispatcher.h"
+#include "benchmark.h"
+
+// =================================================================================================
+// MessageDispatcher with 200 registered keywords, messages arriving in random keyword order:
+// dispatching split messages (as NetworkThread's preParse delivers them), the same messages matched
+// by comparing the keyword against the list of keywords one by one (what applications did before),
+// and dispatching including Assign and the split.
+
+void BenchMessageDispatcher(void) {
+    const int keywordCount = 200;
+    const int count = 200000;
+    std::vector<std::string> keywords;
+    std::vector<std::string> payloads;
+    for (int i = 0; i < keywordCount; i++) {
+        keywords.push_back("object" + std::to_string(i) + "state");
+        payloads.push_back(keywords.back() + "#17;12.5;-3.25;0.5;1;0");
+    }
+    uint64_t handled = 0;
+    MessageDispatcher dispatcher;
+    for (const auto& keyword : keywords)
+        dispatcher.Register(MessageKeyword(std::string_view(keyword)), 6, [&handled](Message&) { ++handled; });
+
+    // one pooled message per keyword, split once
+    std::vector<MessageArena> arenas(keywordCount);
+    std::vector<Message> messages;
+    messages.reserve(keywordCount);
+    for (int i = 0; i < keywordCount; i++) {
+        messages.emplace_back(&arenas[i]);
+        messages.back().Assign(payloads[i].data(), payloads[i].length(), "127.0.0.1", 9100);
+        messages.back().Split();
+    }
+    std::vector<uint8_t> order(count);
+    uint32_t random = 0x9E3779B9;
+    for (auto& i : order) {
+        random = random * 1664525u + 1013904223u;
+        i = uint8_t((random >> 8) % uint32_t(keywordCount));
+    }
+
+    Benchmark::Measure("Dispatch, 200 keywords, split messages", count, [&]() {
+        for (uint8_t i : order)
+            dispatcher.Dispatch(messages[i]);
+    });
+    Benchmark::Measure("keyword list compare, 200 keywords, split messages", count, [&]() {
+        for (uint8_t i : order) {
+            Message& message = messages[i];
+            std::string_view keyword = message.Keyword();
+            for (const auto& k : keywords)
+                if (keyword == k) {
+                    if (message.Validate(6))
+                        ++handled;
+                    break;
+                }
+        }
+    });
+    MessageArena arena;
+    Message pooled(&arena);
+    Benchmark::Measure("Assign + Dispatch, 200 keywords, pooled", count, [&]() {
+        for (uint8_t i : order) {
+            pooled.Assign(payloads[i].data(), payloads[i].length(), "127.0.0.1", 9100);
+            dispatcher.Dispatch(pooled);
+        }
+    });
+    Benchmark::Keep(handled);
+    if (dispatcher.m_unknown or dispatcher.m_malformed)
+        printf("  %llu unknown, %llu malformed\n", (unsigned long long) dispatcher.m_unknown, (unsigned long long) dispatcher.m_malformed);
+}
+
+// =================================================================================================
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <vector>
+
+#include "base_soundhandler.h"
+#include "benchmark.h"
+
+// =================================================================================================
+// Voice churn of BaseSoundHandler: starting sounds (reusing the oldest channel once all 128 are
+// busy), stopping them by owner and the per frame Update. SDL's dummy audio driver is the null
+// backend: the mixer runs, nothing is played (SDL_AUDIODRIVER in the environment overrides it).
+
+class NullSoundHandler
+    : public BaseSoundHandler
+{
+    public:
+        int32_t GetSoundNames(List<String>&) override {
+            return 0;
+        }
+};
+
+
+static void MeasureChurn(BaseSoundHandler& handler, const std::vector<String>& names) {
+    BaseSoundHandler::SoundParams params;
+    Vector3f position = { 1.0f, 0.0f, 1.0f };
+    const int count = 20000;
+    const size_t soundCount = names.size();
+    static char owners[64];
+
+    Benchmark::Measure("Start", count, [&]() {
+        uint64_t n = 0;
+        for (int i = 0; i < count; i++)
+            n += (handler.Start(names[i % soundCount], params, size_t(i), position) != nullptr);
+        Benchmark::Keep(n);
+    });
+    Benchmark::Measure("Start with owner + StopSoundsByOwner", count, [&]() {
+        uint64_t n = 0;
+        for (int i = 0; i < count; i++) {
+            n += (handler.Start(names[i % soundCount], params, size_t(i), position, owners + (i % 64)) != nullptr);
+            if (i % 4 == 3)
+                handler.StopSoundsByOwner(owners + ((i * 13) % 64));
+        }
+        Benchmark::Keep(n);
+    });
+    Benchmark::Measure("Update, all channels busy", count / 10, [&]() {
+        for (int i = 0; i < count / 10; i++) {
+            if (not handler.m_idleChannels.IsEmpty())
+                handler.Start(names[i % soundCount], params, size_t(i), position);
+            handler.Update();
+        }
+    });
+}
+
+
+void BenchSound(void) {
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+    if (0 > SDL_Init(SDL_INIT_AUDIO)) {
+        fprintf(stderr, "  can't initialize SDL audio (%s)\n", SDL_GetError());
+        return;
+    }
+    // 16 sounds of a second of silence each (48 kHz, 16 bit stereo), so started sounds stay busy
+    std::vector<Uint8> silence(48000 * 2 * 2, 0);
+    std::vector<String> names;
+    std::vector<Mix_Chunk*> chunks;
+    {
+        NullSoundHandler handler;
+        handler.Setup(String(""));
+        handler.m_soundLevel = 1;
+        handler.m_masterVolume = 1.0f;
+        for (int i = 0; i < 16; i++) {
+            names.push_back(String(("sound" + std::to_string(i)).c_str()));
+            chunks.push_back(Mix_QuickLoad_RAW(silence.data(), Uint32(silence.size())));
+            handler.m_sounds.Insert(names.back(), chunks.back());
+        }
+        printf("  %d channels\n", handler.m_channelCount);
+        MeasureChurn(handler, names);
+    }   // the channels stop their sounds when the handler goes
+    for (auto chunk : chunks)
+        Mix_FreeChunk(chunk);
+    Mix_CloseAudio();
+    SDL_Quit();
+}
+
+// =================================================================================================
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <utility>
+#include <vector>
+
+#include "table.h"
+#include "benchmark.h"
+
+// =================================================================================================
+// Table<T> neighbourhood access in row major, tiled and Morton layout (the trade-off described in
+// table.h): 3x3 neighbourhoods and 16x16 windows at random places, and 3-tap vertical filters
+// passing the grid in column and in row order. The grid (4096^2 floats, 64 MB) is far bigger than
+// the caches, as the maps and height fields the tiled layouts are meant for.
+
+static void MeasureLayout(int size, TableLayout layout, int tileSize, const std::vector<std::pair<int, int>>& points) {
+    static const char* layoutNames[] = { "row major", "tiled", "Morton" };
+    char prefix[32], name[96];
+    if (layout == TableLayout::RowMajor)
+        snprintf(prefix, sizeof(prefix), "%s", layoutNames[int(layout)]);
+    else
+        snprintf(prefix, sizeof(prefix), "%s %d", layoutNames[int(layout)], tileSize);
+
+    Table<float> table(size, size, layout, tileSize);
+    for (int row = 0; row < size; row++)
+        for (int col = 0; col < size; col++)
+            table(col, row) = float((row * 31 + col * 17) & 255);
+    const size_t pointCount = points.size();
+    const size_t windowCount = pointCount / 8;
+
+    snprintf(name, sizeof(name), "%s: random 3x3 cells (per point)", prefix);
+    Benchmark::Measure(name, pointCount, [&]() {
+        float sum = 0.0f;
+        for (const auto& [col, row] : points)
+            for (int dy = -1; dy <= 1; dy++)
+                for (int dx = -1; dx <= 1; dx++)
+                    sum += table(col + dx, row + dy);
+        Benchmark::Keep(uint64_t(sum));
+    }, 3);
+    snprintf(name, sizeof(name), "%s: random 3x3 views (per point)", prefix);
+    Benchmark::Measure(name, pointCount, [&]() {
+        float sum = 0.0f;
+        for (const auto& [col, row] : points)
+            table.View(col - 1, row - 1, 3, 3).ForEach([&sum](float& v) { sum += v; });
+        Benchmark::Keep(uint64_t(sum));
+    }, 3);
+    snprintf(name, sizeof(name), "%s: random 16x16 views (per view)", prefix);
+    Benchmark::Measure(name, windowCount, [&]() {
+        float sum = 0.0f;
+        for (size_t i = 0; i < windowCount; i++)
+            table.View(points[i].first, points[i].second, 16, 16).ForEach([&sum](float& v) { sum += v; });
+        Benchmark::Keep(uint64_t(sum));
+    }, 3);
+    snprintf(name, sizeof(name), "%s: 3-tap column order pass (per cell)", prefix);
+    Benchmark::Measure(name, size_t(size) * size_t(size - 2), [&]() {
+        float sum = 0.0f;
+        for (int col = 0; col < size; col++)
+            for (int row = 1; row < size - 1; row++)
+                sum += table(col, row - 1) + table(col, row) + table(col, row + 1);
+        Benchmark::Keep(uint64_t(sum));
+    }, 3);
+    snprintf(name, sizeof(name), "%s: 3-tap row order pass (per cell)", prefix);
+    Benchmark::Measure(name, size_t(size) * size_t(size - 2), [&]() {
+        float sum = 0.0f;
+        for (int row = 1; row < size - 1; row++)
+            for (int col = 0; col < size; col++)
+                sum += table(col, row - 1) + table(col, row) + table(col, row + 1);
+        Benchmark::Keep(uint64_t(sum));
+    }, 3);
+}
+
+
+void BenchTable(void) {
+    const int size = 4096;
+    // random points with room for the 3x3 neighbourhood and the 16x16 window
+    std::vector<std::pair<int, int>> points(1000000);
+    uint32_t random = 0x9E3779B9;
+    for (auto& p : points) {
+        random = random * 1664525u + 1013904223u;
+        p.first = 1 + int((random >> 8) % uint32_t(size - 17));
+        random = random * 1664525u + 1013904223u;
+        p.second = 1 + int((random >> 8) % uint32_t(size - 17));
+    }
+    MeasureLayout(size, TableLayout::RowMajor, 16, points);
+    for (int tileSize : { 16, 32 })
+        MeasureLayout(size, TableLayout::Tiled, tileSize, points);
+    for (int tileSize : { 16, 32 })
+        MeasureLayout(size, TableLayout::Morton, tileSize, points);
+}
+
+// =================================================================================================
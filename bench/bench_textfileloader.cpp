@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <vector>
+
+#include "textfileloader.h"
+#include "benchmark.h"
+
+// =================================================================================================
+// TextFileLoader throughput: whole files split into lines, serially, in parallel and from memory
+
+void BenchTextFileLoader(void) {
+    const int lineCount = 200000;
+    std::string fileName = Benchmark::TempFile("apptools_bench.txt");
+    FILE* f = fopen(fileName.c_str(), "wb");
+    if (not f) {
+        fprintf(stderr, "  can't create '%s'\n", fileName.c_str());
+        return;
+    }
+    std::string contents;
+    char line[128];
+    for (int i = 0; i < lineCount; i++) {
+        int l = snprintf(line, sizeof(line), (i % 16 == 0) ? "# section %d\n" : "line %d: %08x the quick brown fox jumps over\n", i, unsigned(i * 2654435761u));
+        contents.append(line, size_t(l));
+    }
+    fwrite(contents.data(), 1, contents.length(), f);
+    fclose(f);
+    printf("  %d lines, %.1f MB\n", lineCount, double(contents.length()) / 1e6);
+
+    auto all = [](String&) { return true; };
+    auto noComments = [](String& line) { return line.Length() and (line[0] != '#'); };
+    TextFileLoader loader;
+    Benchmark::Measure("ReadLines (per line)", lineCount, [&]() {
+        List<String> lines;
+        Benchmark::Keep(uint64_t(loader.ReadLines(fileName.c_str(), lines, all).GetRows()));
+    });
+    Benchmark::Measure("ReadLines, filtered (per line)", lineCount, [&]() {
+        List<String> lines;
+        Benchmark::Keep(uint64_t(loader.ReadLines(fileName.c_str(), lines, noComments).GetRows()));
+    });
+    Benchmark::Measure("ReadLinesParallel (per line)", lineCount, [&]() {
+        List<String> lines;
+        Benchmark::Keep(uint64_t(loader.ReadLinesParallel(fileName.c_str(), lines, all).GetRows()));
+    });
+    Benchmark::Measure("ParseLines from memory (per line)", lineCount, [&]() {
+        List<String> lines;
+        Benchmark::Keep(uint64_t(loader.ParseLines(contents.data(), contents.length(), lines, all).GetRows()));
+    });
+    remove(fileName.c_str());
+}
+
+// =================================================================================================
@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <chrono>
+
+#include "tracing.h"
+#include "benchmark.h"
+
+// =================================================================================================
+// Cost per TRACE_ZONE (the numbers quoted in tracing.h). The zones are TraceZone objects, which is
+// what TRACE_ZONE expands to with USE_TRACING=1, so all cases run whatever APPTOOLS_TRACING is set
+// to; "compiled out" is the bare loop body. Every zone wraps an out of line call (Benchmark::Keep),
+// so the compiler can neither drop nor merge the loop iterations. Recorded events are cleared
+// before each round, so the enabled case appends to warm chunks and never reaches the drop limit.
+
+void BenchTracing(void) {
+    const int count = 200000;
+    Benchmark::Measure("steady_clock::now", count, [&]() {
+        uint64_t sum = 0;
+        for (int i = 0; i < count; i++)
+            sum += uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+        Benchmark::Keep(sum);
+    });
+    double none = Benchmark::Measure("zone compiled out (per call)", count, [&]() {
+        for (int i = 0; i < count; i++)
+            Benchmark::Keep(uint64_t(i));
+    });
+    bool wasEnabled = Tracing::IsEnabled();
+    Tracing::Enable(false);
+    double disabled = Benchmark::Measure("zone disabled (per zone)", count, [&]() {
+        for (int i = 0; i < count; i++) {
+            TraceZone zone("bench");
+            Benchmark::Keep(uint64_t(i));
+        }
+    });
+    Tracing::Enable(true);
+    double enabled = Benchmark::Measure("zone enabled (per zone)", count, [&]() {
+        Tracing::Clear();
+        for (int i = 0; i < count; i++) {
+            TraceZone zone("bench");
+            Benchmark::Keep(uint64_t(i));
+        }
+    });
+    Tracing::Enable(wasEnabled);
+    Tracing::Clear();
+    printf("  %-52s %12.1f ns disabled %8.1f ns enabled\n", "  cost per zone", disabled - none, enabled - none);
+}
+
+// =================================================================================================
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "udp.h"
+#include "udpreceivergroup.h"
+#include "benchmark.h"
+
+// =================================================================================================
+// UDP loopback: messages sent to the own receive socket, one by one and in batches
+
+static const uint16_t benchInPort = 47100;
+static const uint16_t benchOutPort = 47101;
+static const uint16_t floodPort = 47110;
+static const uint16_t floodSenderPort = 47200;
+static const uint16_t scalingPort = 47120;
+
+
+static void Drain(UDP& udp) {
+    while (not udp.Receive().IsEmpty())
+        ;
+}
+
+
+void BenchUDP(void) {
+    UDP udp;
+    udp.m_localAddress = String("0.0.0.0");
+    UDPSocketParams params;
+    params.receiveBufferSize = 4 << 20;
+    params.sendBufferSize = 4 << 20;
+    if (not (udp.OpenSocket(benchInPort, 0, params) and udp.OpenSocket(benchOutPort, 1, params))) {
+        fprintf(stderr, "  can't open UDP ports %u and %u\n", unsigned(benchInPort), unsigned(benchOutPort));
+        return;
+    }
+    UDPPeer peer(String("127.0.0.1"), benchInPort);
+    const char* message = "move#17;12.5;-3.25;0.5;1;0";
+    size_t length = strlen(message);
+    const int count = 50000;
+    uint64_t lost = 0;
+
+    Drain(udp);
+    Benchmark::Measure("Transmit + Receive", count, [&]() {
+        for (int i = 0; i < count; i++) {
+            udp.Transmit(peer, message, length);
+            lost += udp.Receive().IsEmpty();
+        }
+    });
+
+    const int batchSize = 64;
+    UDPDatagramRing ring(batchSize * 2);
+    Drain(udp);
+    Benchmark::Measure("Queue + Flush + ReceiveBatch, 64 per batch", count, [&]() {
+        Message m;
+        for (int i = 0; i < count; i += batchSize) {
+            for (int j = 0; j < batchSize; j++)
+                udp.Queue(peer.m_target, message, length);
+            udp.Flush();
+            int received = 0;
+            for (int tries = 0; (received < batchSize) and (tries < 100); tries++)
+                received += udp.ReceiveBatch(ring);
+            lost += uint64_t(batchSize - received);
+            for (; not ring.IsEmpty(); ring.Pop()) {
+                uint16_t offset = 0;
+                while (UDP::NextMessage(ring.Front(), offset, m))
+                    ;
+            }
+        }
+    });
+    if (lost)
+        printf("  %llu messages lost\n", (unsigned long long) lost);
+}
+
+// =================================================================================================
+// Flood test: a sender thread blasts datagrams at the receive socket as fast as sendmmsg takes them
+// while the receiving thread drains it, one datagram per call (UDPSocket::Receive, as UDP::Receive
+// does) or in batches into a datagram ring. Whatever the receiver doesn't drain in time overflows
+// the socket's receive buffer and is dropped by the kernel. Reports received packets per second and
+// the share of dropped ones.
+
+// send count datagrams from localPort to port; returns the number the socket took
+static uint64_t Flood(uint16_t localPort, uint16_t port, uint32_t count) {
+    UDPSocket socket;
+    UDPSocketParams params;
+    params.sendBufferSize = 4 << 20;
+    if (not socket.Open(String("0.0.0.0"), localPort, params))
+        return 0;
+    UDPAddress target = UDPPeer(String("127.0.0.1"), port).m_target;
+    const char* message = "move#17;12.5;-3.25;0.5;1;0;0123456789abcdef";
+    size_t length = strlen(message);
+    UDPSendQueue queue(64);
+    uint64_t sent = 0;
+    for (uint32_t i = 0; i < count; ) {
+        while ((i < count) and queue.Queue(target, UDP_MESSAGE_PREFIX, UDP_MESSAGE_PREFIX_LENGTH, message, length))
+            ++i;
+        int n = socket.SendBatch(queue);
+        if (n > 0)
+            sent += uint64_t(n);
+    }
+    return sent;
+}
+
+
+static void MeasureFlood(const char* name, bool isBatched, int receiveBufferSize) {
+    const uint32_t count = 500000;
+    UDPSocketParams params;
+    params.receiveBufferSize = receiveBufferSize;
+    UDPSocket socket;
+    if (not socket.Open(String("0.0.0.0"), floodPort, params)) {
+        fprintf(stderr, "  can't open UDP port %u\n", unsigned(floodPort));
+        return;
+    }
+    UDPDatagramRing ring(256);
+    UDPDatagram datagram;
+    std::atomic<bool> isDone(false);
+    uint64_t sent = 0;
+    uint64_t start = Benchmark::Now();
+    std::thread sender([&]() {
+        sent = Flood(floodSenderPort, floodPort, count);
+        isDone = true;
+    });
+    uint64_t received = 0, last = start, idleSince = 0;
+    for (;;) {
+        int n = 0;
+        if (isBatched) {
+            n = socket.ReceiveBatch(ring);
+            ring.Clear();
+        }
+        else
+            while (socket.Receive(datagram))
+                ++n;
+        uint64_t now = Benchmark::Now();
+        if (n > 0) {
+            received += uint64_t(n);
+            last = now;
+            idleSince = 0;
+        }
+        else if (isDone) {  // the sender is done and the socket has been empty for 20 ms
+            if (idleSince == 0)
+                idleSince = now;
+            else if (now - idleSince > 20000000)
+                break;
+        }
+        else
+            std::this_thread::yield();
+    }
+    sender.join();
+    double seconds = double(last - start) * 1e-9;
+    printf("  %-52s %12.0f pkt/s %8.2f%% dropped\n", name, (seconds > 0.0) ? double(received) / seconds : 0.0,
+           sent ? 100.0 * double(sent - std::min(received, sent)) / double(sent) : 0.0);
+    fflush(stdout);
+}
+
+
+void BenchUDPFlood(void) {
+    MeasureFlood("Receive, one per call, default buffer", false, 0);
+    MeasureFlood("ReceiveBatch into a ring, default buffer", true, 0);
+    MeasureFlood("Receive, one per call, 4 MB buffer", false, 4 << 20);
+    MeasureFlood("ReceiveBatch into a ring, 4 MB buffer", true, 4 << 20);
+}
+
+// =================================================================================================
+// Receive scaling: 8 flooding senders (8 flows) against a UDPReceiverGroup of 1, 2, 4 and 8
+// receivers sharing the port (SO_REUSEPORT). Every receiver parses its datagrams into pooled
+// messages, so there is work to spread besides draining the sockets.
+
+static void MeasureScaling(int receiverCount) {
+    const int senderCount = 8;
+    const uint32_t count = 100000;     // per sender
+    uint16_t port = uint16_t(scalingPort + receiverCount);
+    UDPSocketParams params;
+    params.receiveBufferSize = 4 << 20;
+    std::atomic<uint64_t> valid(0);
+    UDPReceiverGroup group;
+    bool isStarted = group.Start(String("0.0.0.0"), port, receiverCount, [&valid](int, UDPDatagramRing& ring) {
+        MessageArena arena;
+        Message message(&arena);
+        uint64_t n = 0;
+        for (; not ring.IsEmpty(); ring.Pop()) {
+            uint16_t offset = 0;
+            while (UDP::NextMessage(ring.Front(), offset, message))
+                n += message.Validate(7);
+        }
+        valid.fetch_add(n, std::memory_order_relaxed);
+    }, params);
+    if (not isStarted) {
+        fprintf(stderr, "  can't start %d receivers on UDP port %u\n", receiverCount, unsigned(port));
+        return;
+    }
+    std::atomic<uint64_t> sent(0);
+    std::atomic<int> running(senderCount);
+    uint64_t start = Benchmark::Now();
+    std::vector<std::thread> senders;
+    for (int i = 0; i < senderCount; i++)
+        senders.emplace_back([&sent, &running, i, port]() {
+            sent += Flood(uint16_t(floodSenderPort + i), port, count);
+            --running;
+        });
+    // wait for the senders, then until nothing has arrived for 20 ms
+    uint64_t received = 0, last = start;
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        uint64_t now = Benchmark::Now();
+        uint64_t n = group.Received();
+        if (n != received) {
+            received = n;
+            last = now;
+        }
+        else if ((running == 0) and (now - last > 20000000))
+            break;
+    }
+    for (auto& t : senders)
+        t.join();
+    group.Stop();
+    char name[64];
+    snprintf(name, sizeof(name), "%d receiver%s, %d flows", receiverCount, (receiverCount > 1) ? "s" : "", senderCount);
+    double seconds = double(last - start) * 1e-9;
+    printf("  %-52s %12.0f pkt/s %8.2f%% dropped %10llu valid\n", name, (seconds > 0.0) ? double(received) / seconds : 0.0,
+           sent ? 100.0 * double(sent - std::min(received, sent.load())) / double(sent) : 0.0, (unsigned long long) valid.load());
+    fflush(stdout);
+}
+
+
+void BenchUDPScaling(void) {
+    printf("  %u hardware threads\n", std::thread::hardware_concurrency());
+    for (int receivers = 1; receivers <= 8; receivers *= 2)
+        MeasureScaling(receivers);
+}
+
+// =================================================================================================
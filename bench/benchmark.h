@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <string>
+
+// =================================================================================================
+// Microbenchmark harness of the apptools_bench executable (CMake option APPTOOLS_BENCHMARKS).
+// Every module has a Bench<Module>() function that measures its cases with Measure() and prints one
+// line per case. A case runs its body once to warm up, then rounds times, and reports the fastest
+// round: on an otherwise idle machine that is the most repeatable number to compare against.
+
+class Benchmark {
+    public:
+        // ns of the steady clock
+        static inline uint64_t Now(void) {
+            return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        // body performs ops operations per call; returns ns per operation of the fastest round
+        template <typename F>
+        static double Measure(const char* name, size_t ops, F&& body, int rounds = 5) {
+            body();
+            uint64_t best = UINT64_MAX;
+            for (int i = 0; i < rounds; i++) {
+                uint64_t t = Now();
+                body();
+                t = Now() - t;
+                if (best > t)
+                    best = t;
+            }
+            double ns = double(best) / double(ops ? ops : 1);
+            printf("  %-52s %12.1f ns/op %14.0f op/s\n", name, ns, (ns > 0.0) ? 1e9 / ns : 0.0);
+            fflush(stdout);
+            return ns;
+        }
+
+        // keeps the compiler from dropping computations whose result is otherwise unused
+        static void Keep(uint64_t value);
+
+        // file for benchmark data in the system's temporary directory
+        static std::string TempFile(const char* name);
+};
+
+// =================================================================================================
+
+void BenchArgHandler(void);
+
+void BenchCompressor(void);
+
+void BenchDeltaCodec(void);
+
+void BenchJobSystem(void);
+
+void BenchTextFileLoader(void);
+
+void BenchTracing(void);
+
+void BenchMessage(void);
+
+void BenchMessageDispatcher(void);
+
+void BenchSound(void);
+
+void BenchTable(void);
+
+void BenchUDP(void);
+
+void BenchUDPFlood(void);
+
+void BenchUDPScaling(void);
+
+// =================================================================================================
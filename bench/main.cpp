@@ -0,0 +1,70 @@
+#include <string.h>
+#include <stdio.h>
+#include <filesystem>
+
+#include "benchmark.h"
+
+// =================================================================================================
+// apptools_bench [name ...]: run the named benchmarks (all without names); -l lists them
+
+static volatile uint64_t keep;
+
+void Benchmark::Keep(uint64_t value) {
+    keep = value;
+}
+
+
+std::string Benchmark::TempFile(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// =================================================================================================
+
+struct BenchmarkEntry {
+    const char* name;
+    void        (*run)(void);
+};
+
+static const BenchmarkEntry benchmarks[] = {
+    { "arghandler", BenchArgHandler },
+    { "compressor", BenchCompressor },
+    { "deltacodec", BenchDeltaCodec },
+    { "jobsystem", BenchJobSystem },
+    { "textfileloader", BenchTextFileLoader },
+    { "tracing", BenchTracing },
+    { "message", BenchMessage },
+    { "dispatcher", BenchMessageDispatcher },
+    { "sound", BenchSound },
+    { "table", BenchTable },
+    { "udp", BenchUDP },
+    { "udpflood", BenchUDPFlood },
+    { "udpscaling", BenchUDPScaling },
+};
+
+
+static bool IsSelected(const char* name, int argC, char** argV) {
+    if (argC < 2)
+        return true;
+    for (int i = 1; i < argC; i++)
+        if (not strcmp(argV[i], name))
+            return true;
+    return false;
+}
+
+
+int main(int argC, char** argV) {
+    if ((argC > 1) and not strcmp(argV[1], "-l")) {
+        for (const auto& b : benchmarks)
+            printf("%s\n", b.name);
+        return 0;
+    }
+    for (const auto& b : benchmarks) {
+        if (not IsSelected(b.name, argC, argV))
+            continue;
+        printf("%s\n", b.name);
+        b.run();
+    }
+    return 0;
+}
+
+// =================================================================================================
@@ -3,6 +3,7 @@
 #include "std_defines.h"
 
 #include <string>
+#include <memory_resource>
 
 #include "singletonbase.hpp"
 #include "string.hpp"
@@ -111,7 +112,8 @@ class ArgHandler
 
         int LoadArgs(int argC, char** argV);
 
-        int LoadArgs(const char* fileName = "smileybattle.ini");
+        // resource: for the loader's temporary buffers, e.g. an ArenaResource released after loading
+        int LoadArgs(const char* fileName = "smileybattle.ini", std::pmr::memory_resource* resource = nullptr);
 
         Argument* GetArg(const char* key);
 
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "singletonbase.hpp"
+#include "textfileloader.h"
+#include "networkstats.h"
+
+// =================================================================================================
+// Background file loading. Loads are queued with a priority and run on dedicated I/O threads (not
+// on the job system, whose workers shouldn't block in read calls); the result comes back as a
+// future or through a callback, which runs on the I/O thread.
+// Requests of a more urgent priority always go first, so a file needed now overtakes queued
+// prefetches; within a priority, requests run in the order they were made.
+// On POSIX systems every file queued as Soon or Prefetch gets a read-ahead hint (posix_fadvise
+// WILLNEED) as soon as an I/O thread is between two loads, so the kernel reads it in while the loads
+// queued before it are still running; Prefetch() gives just the hint. Hints are given on the I/O
+// threads because they can take milliseconds on a cold cache, one at a time and only while no Now
+// load is waiting, so they never hold up a file needed now. Files are read sequentially
+// (POSIX_FADV_SEQUENTIAL) with a single buffer allocation.
+
+enum class LoadPriority {
+    Now = 0,        // needed for the current frame
+    Soon = 1,       // needed for the next step (e.g. the level being entered)
+    Prefetch = 2    // speculative
+};
+
+#define LOAD_PRIORITIES 3
+
+
+class FileBuffer {
+    public:
+        std::vector<char>   m_data;
+        int                 m_error;    // 0 or the errno of the failed call
+
+        FileBuffer() : m_error(0) {}
+
+        inline bool IsValid(void) const {
+            return m_error == 0;
+        }
+};
+
+
+class TextFile {
+    public:
+        List<String>        m_lines;
+        TableDimensions     m_dimensions;
+        int                 m_error;
+
+        TextFile() : m_error(0) {}
+
+        inline bool IsValid(void) const {
+            return m_error == 0;
+        }
+};
+
+
+class AsyncFileLoader
+    : public BaseSingleton<AsyncFileLoader>
+{
+    public:
+        typedef std::chrono::steady_clock tClock;
+        typedef std::function<void(FileBuffer& file)> tFileCallback;
+        typedef std::function<void(TextFile& file)> tTextCallback;
+
+        class Request {
+            public:
+                LoadPriority        m_priority;
+                uint64_t            m_sequence;
+                std::string         m_fileName;
+                tClock::time_point  m_queued;
+                tFileCallback       m_complete;
+
+                // priority_queue puts the greatest element on top: the most urgent, then the oldest one
+                inline bool operator< (const Request& other) const {
+                    return (m_priority != other.m_priority) ? m_priority > other.m_priority : m_sequence > other.m_sequence;
+                }
+        };
+
+        std::vector<std::thread>        m_threads;
+        std::priority_queue<Request>    m_requests;
+        std::deque<std::string>         m_hints;        // files to give a read-ahead hint for
+        std::mutex                      m_lock;
+        std::condition_variable         m_wake;
+        bool                            m_isRunning;
+        uint64_t                        m_nextSequence;
+        // statistics
+        std::atomic<uint64_t>           m_loaded;
+        std::atomic<uint64_t>           m_failed;
+        std::atomic<uint64_t>           m_bytes;
+        LatencyHistogram                m_waitTime[LOAD_PRIORITIES];   // µs from queueing to the start of the read
+        LatencyHistogram                m_readTime;                    // µs per read
+
+        AsyncFileLoader(int threadCount = 2);
+
+        // stops the threads after the running loads; queued loads are dropped (their futures report broken promises)
+        ~AsyncFileLoader();
+
+        AsyncFileLoader(const AsyncFileLoader&) = delete;
+
+        AsyncFileLoader& operator=(const AsyncFileLoader&) = delete;
+
+        // load the whole file
+        std::future<FileBuffer> Read(const char* fileName, LoadPriority priority = LoadPriority::Now);
+
+        void Read(const char* fileName, tFileCallback callback, LoadPriority priority = LoadPriority::Now);
+
+        // load the file and split it into lines like TextFileLoader::ReadLines (CR LF line ends are
+        // accepted, too). The filter runs on the I/O thread.
+        std::future<TextFile> ReadLines(const char* fileName, TextFileLoader::tLineFilter filter, LoadPriority priority = LoadPriority::Now);
+
+        void ReadLines(const char* fileName, TextFileLoader::tLineFilter filter, tTextCallback callback, LoadPriority priority = LoadPriority::Now);
+
+        // only ask the operating system to read the file into its cache (no-op where that's not supported)
+        void Prefetch(const char* fileName);
+
+        // stop giving hints when this many are waiting (the hints of a long queue would only evict each other)
+        static constexpr size_t maxHints = 64;
+
+        inline size_t Pending(void) {
+            std::lock_guard<std::mutex> lock(m_lock);
+            return m_requests.size();
+        }
+
+    private:
+        static void Hint(const std::string& fileName);
+
+        void Queue(const char* fileName, LoadPriority priority, tFileCallback complete);
+
+        void Load(const Request& request, FileBuffer& file);
+
+        void Run(void);
+};
+
+#define fileLoader AsyncFileLoader::Instance()
+
+// =================================================================================================
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "string.hpp"
+#include "networkmessage.h"
+#include "udp.h"
+
+// =================================================================================================
+// Per-peer delta compression for repeated state messages.
+// Keywords registered with Register() are treated as entity state: the first keyFields values
+// identify the entity, the remaining ones are its state. For every peer the encoder remembers the
+// last states it sent and which of them the peer has acknowledged. A new state is sent as delta to
+// the newest acknowledged one (only the changed fields and a bit mask telling which ones they are).
+// If there is no usable acknowledged state (nothing acked yet, acked state too old, field count
+// changed), the full state is sent instead. Losing a delta therefore only costs bandwidth.
+//
+// Wire format (values after the key fields are the state fields, numbers in the header are hex):
+//   full:  keyword#@<port>:<seq>;<keys>;<all fields>
+//   delta: keyword#!<seq>:<seq - base seq>:<field mask>;<keys>;<changed fields>
+//   ack:   @dack#<port>;<seq>;<seq>...
+// <port> is the sender's receive port, so the other side knows where to send its acks to
+// (datagrams come from the sender's send socket). Deltas are matched to the sender by the address
+// they come from, which the preceding full state has announced. Both sides must register the same keywords.
+// The decoder rebuilds the complete original message, so message handlers don't change.
+
+#define DELTA_HISTORY_SIZE  32
+#define DELTA_MAX_FIELDS    64
+
+class DeltaCodec {
+    public:
+        class State {
+            public:
+                uint32_t                    m_sequence;
+                std::vector<std::string>    m_values;
+
+                State() : m_sequence(0) {}
+        };
+
+        // last states sent or received for one entity
+        class StateHistory {
+            public:
+                State       m_states[DELTA_HISTORY_SIZE];
+                uint32_t    m_ackedSequence;
+
+                StateHistory() : m_ackedSequence(0) {}
+
+                inline State* Find(uint32_t sequence) {
+                    State& s = m_states[sequence % DELTA_HISTORY_SIZE];
+                    return ((sequence != 0) and (s.m_sequence == sequence)) ? &s : nullptr;
+                }
+
+                // slot for sequence; the state it held before (if any) is overwritten
+                inline State& Add(uint32_t sequence) {
+                    State& s = m_states[sequence % DELTA_HISTORY_SIZE];
+                    s.m_sequence = sequence;
+                    return s;
+                }
+
+                inline State& Slot(uint32_t sequence) {
+                    return m_states[sequence % DELTA_HISTORY_SIZE];
+                }
+        };
+
+        class PeerState {
+            public:
+                uint32_t                                        m_nextSequence;
+                std::unordered_map<std::string, StateHistory>   m_sent;
+                // sequence -> entity it was sent for, while the state is still in the entity's history
+                // (at most DELTA_HISTORY_SIZE per entity); acked or overwritten sequences are removed
+                std::unordered_map<uint32_t, StateHistory*>     m_sentBySequence;
+                std::unordered_map<std::string, StateHistory>   m_received;
+                std::vector<uint32_t>                           m_pendingAcks;
+                UDPPeer                                         m_replyPeer;
+                // statistics
+                uint64_t                                        m_rawBytes;
+                uint64_t                                        m_encodedBytes;
+
+                PeerState() : m_nextSequence(1), m_rawBytes(0), m_encodedBytes(0) {}
+        };
+
+        enum class tResult {
+            Passed,     // not delta coded, message unchanged
+            Decoded,    // message rebuilt from full state or delta
+            Consumed,   // codec control message (ack), nothing for the application
+            Dropped     // delta without known baseline
+        };
+
+        UDP&                                    m_udp;
+        std::unordered_map<std::string, int>    m_keywords;     // keyword -> number of key fields
+        std::unordered_map<uint64_t, PeerState> m_peers;        // UDPAddress key (host + receive port) -> state
+        std::unordered_map<uint64_t, uint64_t>  m_senders;      // UDPAddress key of sending socket -> peer key
+        // statistics
+        uint64_t                                m_fullStates;
+        uint64_t                                m_deltaStates;
+        uint64_t                                m_undecodable;
+
+        DeltaCodec(UDP& udp) : m_udp(udp), m_fullStates(0), m_deltaStates(0), m_undecodable(0) {}
+
+        inline void Register(const char* keyword, int keyFields = 1) {
+            m_keywords[keyword] = keyFields;
+        }
+
+        // encode message for peer and send it
+        bool Transmit(const UDPPeer& peer, const String& message);
+
+        // receive the next application message, handling acks and decoding states on the way
+        bool Receive(Message& message);
+
+        tResult Decode(Message& message);
+
+        // queue pending acks and flush the send queue (call once per tick)
+        int Flush(void);
+
+        // encoded size relative to the original size for peer (1.0: no savings)
+        float Ratio(const UDPPeer& peer);
+
+    private:
+        bool Encode(PeerState& peer, const char* message, size_t length, std::string& encoded);
+
+        void Acknowledge(PeerState& peer, uint32_t sequence);
+};
+
+// =================================================================================================
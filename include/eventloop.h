@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "udp.h"
+#include "networkstats.h"
+
+// =================================================================================================
+// Event loop for any number of sockets and timers. RunOnce() sleeps until a registered socket has
+// data or the next timer is due and then calls the handlers of exactly those sockets and timers,
+// so idle sockets cost nothing.
+// Backends: epoll with a timerfd for precise deadlines on Linux, poll() on other POSIX systems (both
+// with USE_POSIX_SOCKETS=1), SDLNet_CheckSockets with the SDL_net backend. poll() and SDL_net only
+// wait with millisecond resolution, and SDL_net can't be woken early by Stop().
+// Socket handlers are level triggered: they are called again as long as data is pending, so they
+// should drain the socket (e.g. with ReceiveBatch). Shared memory inboxes aren't watched.
+
+class EventLoop {
+    public:
+        typedef std::chrono::steady_clock tClock;
+        typedef std::function<void(UDPSocket& socket)> tSocketHandler;
+        typedef std::function<void(void)> tTimerHandler;
+
+        class Watch {
+            public:
+                UDPSocket*      m_socket;
+                tSocketHandler  m_handler;
+        };
+
+        class Timer {
+            public:
+                tClock::time_point  m_deadline;
+                int                 m_id;
+                int64_t             m_interval; // µs; 0: one shot
+
+                inline bool operator> (const Timer& other) const {
+                    return m_deadline > other.m_deadline;
+                }
+        };
+
+        std::vector<std::unique_ptr<Watch>>     m_watches;
+        std::vector<std::unique_ptr<Watch>>     m_removed;          // removed during dispatch, deleted after it
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> m_timers;
+        std::unordered_map<int, tTimerHandler>  m_timerHandlers;    // active timers
+        int                                     m_nextTimerId;
+        std::atomic<bool>                       m_isRunning;        // cleared by Stop(), set again by Start()
+#if USE_POSIX_SOCKETS
+#   ifdef __linux__
+        int                                     m_epoll;
+        int                                     m_timerFd;
+        int                                     m_wakeFd;           // eventfd for Stop()
+        tClock::time_point                      m_armedDeadline;    // what m_timerFd is set to
+#   else
+        int                                     m_wakePipe[2];
+#   endif
+#else
+        SDLNet_SocketSet                        m_socketSet;
+        int                                     m_socketSetSize;
+#endif
+        // statistics
+        uint64_t                                m_wakeups;
+        uint64_t                                m_socketEvents;
+        uint64_t                                m_timerEvents;
+        LatencyHistogram                        m_timerLateness;    // µs from deadline to handler call
+
+        EventLoop();
+
+        ~EventLoop();
+
+        EventLoop(const EventLoop&) = delete;
+
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        bool AddSocket(UDPSocket& socket, tSocketHandler handler);
+
+        bool RemoveSocket(UDPSocket& socket);
+
+        // call handler once after delay ms, or every delay ms if repeat is set. Returns the timer id.
+        int AddTimer(int delay, tTimerHandler handler, bool repeat = false);
+
+        inline int AddTimer(std::chrono::microseconds delay, tTimerHandler handler, bool repeat = false) {
+            return ScheduleTimer(delay, std::move(handler), repeat);
+        }
+
+        void CancelTimer(int id);
+
+        // wait up to maxWait ms (-1: until something happens) and dispatch; returns the number of handlers called
+        int RunOnce(int maxWait = -1);
+
+        // dispatch until Stop() is called (from a handler or another thread). Returns at once if Stop()
+        // was called before; Start() makes a stopped loop runnable again.
+        void Run(void);
+
+        // undo a Stop(); call it before Run(), from the thread that runs the loop
+        void Start(void);
+
+        void Stop(void);
+
+    private:
+        int ScheduleTimer(std::chrono::microseconds delay, tTimerHandler handler, bool repeat);
+
+        // deadline of the next active timer; default time_point if there is none
+        tClock::time_point NextDeadline(void);
+
+        // ms until the next timer is due, capped by maxWait; -1: no timer and no cap
+        int WaitTime(int maxWait);
+
+        int RunTimers(void);
+
+        // block until a socket is ready, the next timer is due or maxWait ms passed; calls the socket handlers
+        int Wait(int maxWait);
+
+        int Dispatch(Watch& watch);
+
+        void Unwatch(UDPSocket& socket);
+
+        void Wake(void);
+};
+
+// =================================================================================================
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "networkstats.h"
+
+// =================================================================================================
+// Frame scheduler for the main loop. Subsystem updates (sound, draining the network, ...) are
+// registered as tasks with a rate and a time budget per frame; RunFrame() calls each of them in
+// registration order:
+// - tasks with a rate run at a fixed timestep: as many steps as the time since the last frame
+//   calls for, at most maxCatchUp per frame. Time beyond that is dropped (counted as skipped steps)
+//   instead of piling up after a stall.
+// - tasks with rate 0 run once per frame and are called again while they report work left and
+//   their budget lasts (see Drain).
+// A task that has used up its budget stops for this frame; the remaining steps stay due and run in
+// the next frames. Work is never interrupted: a single call that takes longer than the budget is
+// reported as an overrun (statistics and the overrun hook). Tasks must not add or remove tasks.
+
+class FrameTask {
+    public:
+        typedef std::chrono::steady_clock tClock;
+        // called with the time the task's budget ends; returns true if work is left (rate 0 tasks
+        // are called again then, if the budget allows)
+        typedef std::function<bool(tClock::time_point deadline)> tUpdate;
+
+        int                 m_id;
+        const char*         m_name;         // must outlive the task
+        tUpdate             m_update;
+        int64_t             m_interval;     // µs per step; 0: once per frame
+        int64_t             m_budget;       // µs per frame; 0: unlimited
+        int                 m_maxCatchUp;   // steps per frame at most
+        int64_t             m_accumulator;  // µs not stepped yet
+        // statistics
+        uint64_t            m_steps;        // update calls
+        uint64_t            m_skipped;      // steps dropped by the catch-up limit
+        uint64_t            m_deferred;     // frames that ended with steps due or work left
+        uint64_t            m_overruns;     // frames in which the task exceeded its budget
+        LatencyHistogram    m_time;         // µs per frame
+
+        FrameTask(int id, const char* name, tUpdate update, int64_t interval, int64_t budget, int maxCatchUp)
+            : m_id(id), m_name(name), m_update(update), m_interval(interval), m_budget(budget), m_maxCatchUp(maxCatchUp),
+              m_accumulator(0), m_steps(0), m_skipped(0), m_deferred(0), m_overruns(0)
+        { }
+};
+
+
+class FrameScheduler {
+    public:
+        typedef FrameTask::tClock tClock;
+        typedef std::function<void(const FrameTask& task, int64_t time)> tOverrunHook;  // time in µs
+
+        std::vector<std::unique_ptr<FrameTask>> m_tasks;
+        int64_t                                 m_frameInterval;    // µs
+        tClock::time_point                      m_lastFrame;        // start of the previous frame
+        tClock::time_point                      m_nextFrame;        // see WaitForNextFrame
+        int                                     m_nextId;
+        tOverrunHook                            m_onOverrun;
+        // statistics
+        uint64_t                                m_frames;
+        uint64_t                                m_frameOverruns;    // frames whose tasks took longer than the frame interval
+        LatencyHistogram                        m_frameTime;        // µs spent in the tasks per frame
+
+        FrameScheduler(int frameRate = 60);
+
+        // rate: steps per second, 0: once per frame. budget: µs per frame, 0: unlimited.
+        // Returns the task id.
+        int Add(const char* name, FrameTask::tUpdate update, int rate = 0, int budget = 0, int maxCatchUp = 4);
+
+        bool Remove(int id);
+
+        FrameTask* Task(int id);
+
+        // called with the task and its time (µs) whenever a task exceeds its budget
+        inline void SetOverrunHook(tOverrunHook hook) {
+            m_onOverrun = hook;
+        }
+
+        // run all tasks that are due; returns the µs spent in them
+        int64_t RunFrame(void);
+
+        // sleep until the next frame is due (fixed frame rate); returns at once if it is overdue
+        void WaitForNextFrame(void);
+
+        // update function for a rate 0 task that calls step() until it returns false (nothing left),
+        // at most maxItems times per call and no longer than the task's budget (checked between
+        // items, so one item may overshoot it), e.g. to drain a bounded number of messages per frame
+        static FrameTask::tUpdate Drain(std::function<bool(void)> step, int maxItems);
+
+        std::string ToText(void) const;
+
+    private:
+        void Run(FrameTask& task, tClock::time_point now, int64_t elapsed);
+};
+
+// =================================================================================================
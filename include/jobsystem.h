@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "singletonbase.hpp"
+
+// =================================================================================================
+// Work stealing thread pool. Every worker has its own deque: it pushes and pops jobs at the back
+// (newest first, so related work stays in its cache), idle workers steal from the front of the
+// others' deques (oldest, usually biggest pieces of work). Jobs submitted from other threads are
+// spread round robin over the workers.
+// A thread waiting for a TaskGroup runs queued jobs meanwhile instead of blocking, so jobs may wait
+// for jobs they spawned. Blocking on an Async future inside a job takes a worker out of the game;
+// use a TaskGroup there. Jobs run through Run/ParallelFor must not throw (Async passes exceptions on).
+
+class JobSystem
+    : public BaseSingleton<JobSystem>
+{
+    public:
+        typedef std::function<void(void)> tJob;
+
+        class TaskGroup {
+            public:
+                std::atomic<int>    m_pending;
+
+                TaskGroup() : m_pending(0) {}
+
+                inline bool IsDone(void) const {
+                    return m_pending.load(std::memory_order_acquire) == 0;
+                }
+        };
+
+        class Job {
+            public:
+                tJob        m_job;
+                TaskGroup*  m_group;
+        };
+
+        class Worker {
+            public:
+                std::mutex          m_lock;
+                std::deque<Job>     m_jobs;
+                std::thread         m_thread;
+        };
+
+        std::vector<std::unique_ptr<Worker>>    m_workers;
+        std::atomic<bool>                       m_isRunning;
+        std::atomic<int>                        m_queued;       // jobs in all deques
+        std::atomic<int>                        m_sleeping;     // workers waiting for m_wake
+        std::mutex                              m_idleLock;
+        std::condition_variable                 m_wake;
+        std::atomic<uint32_t>                   m_nextWorker;   // round robin target for outside submissions
+        // statistics
+        std::atomic<uint64_t>                   m_executed;
+        std::atomic<uint64_t>                   m_stolen;
+
+        // workerCount <= 0: one worker per hardware thread except the caller's (at least one)
+        JobSystem(int workerCount = 0);
+
+        // stops the workers; jobs that haven't started yet are discarded
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        inline int WorkerCount(void) const {
+            return int(m_workers.size());
+        }
+
+        // queue job as part of group
+        void Run(TaskGroup& group, tJob job);
+
+        // queue job without anybody waiting for it
+        void Submit(tJob job);
+
+        // run queued jobs until every job of group has finished
+        void Wait(TaskGroup& group);
+
+        // queue f and return a future for its result
+        template <typename F>
+        auto Async(F&& f) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+            typedef std::invoke_result_t<std::decay_t<F>> tResult;
+            auto task = std::make_shared<std::packaged_task<tResult()>>(std::forward<F>(f));
+            std::future<tResult> result = task->get_future();
+            Submit([task]() { (*task)(); });
+            return result;
+        }
+
+        // call body(first, last) for consecutive ranges of at most grain indices covering [begin, end)
+        // and return when all are done. The calling thread takes part.
+        template <typename F>
+        void ParallelFor(size_t begin, size_t end, size_t grain, F&& body) {
+            if (grain == 0)
+                grain = 1;
+            if (end - begin <= grain) {
+                if (begin < end)
+                    body(begin, end);
+                return;
+            }
+            TaskGroup group;
+            for (size_t first = begin + grain; first < end; first += grain) {
+                size_t last = (end - first > grain) ? first + grain : end;
+                Run(group, [&body, first, last]() { body(first, last); });
+            }
+            body(begin, begin + grain);
+            Wait(group);
+        }
+
+    private:
+        void Push(Job&& job);
+
+        // run one job: the newest of the own deque (worker threads) or the oldest of another one
+        bool RunOne(void);
+
+        void WorkerLoop(int index);
+};
+
+#define jobSystem JobSystem::Instance()
+
+// =================================================================================================
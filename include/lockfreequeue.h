@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <utility>
+
+// =================================================================================================
+// Bounded lock-free queue (D. Vyukov's array based MPMC queue). Every cell carries a sequence number
+// that tells producers and consumers whether the cell is free or filled for their current lap,
+// so Push and Pop only need one CAS on the shared position. Safe for any number of producers and
+// consumers, which covers the SPSC and MPSC cases used between the game and network threads.
+// Capacity is rounded up to a power of two.
+
+template <typename T>
+class LockFreeQueue {
+    private:
+        struct Cell {
+            std::atomic<size_t> m_sequence;
+            T                   m_data;
+        };
+
+        static constexpr size_t cacheLineSize = 64;
+
+        Cell*                                   m_cells;
+        size_t                                  m_mask;
+        alignas(cacheLineSize) std::atomic<size_t>  m_pushPos;
+        alignas(cacheLineSize) std::atomic<size_t>  m_popPos;
+
+    public:
+        LockFreeQueue(size_t capacity = 1024) {
+            size_t size = 2;
+            while (size < capacity)
+                size <<= 1;
+            m_cells = new Cell[size];
+            m_mask = size - 1;
+            for (size_t i = 0; i < size; i++)
+                m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+            m_pushPos.store(0, std::memory_order_relaxed);
+            m_popPos.store(0, std::memory_order_relaxed);
+        }
+
+        ~LockFreeQueue() {
+            delete[] m_cells;
+            m_cells = nullptr;
+        }
+
+        LockFreeQueue(const LockFreeQueue&) = delete;
+
+        LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+        template <typename V>
+        bool Push(V&& value) {
+            Cell* cell;
+            size_t pos = m_pushPos.load(std::memory_order_relaxed);
+            for (;;) {
+                cell = &m_cells[pos & m_mask];
+                size_t sequence = cell->m_sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+                if (diff == 0) {
+                    if (m_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                    return false; // full
+                else
+                    pos = m_pushPos.load(std::memory_order_relaxed);
+            }
+            cell->m_data = std::forward<V>(value);
+            cell->m_sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool Pop(T& value) {
+            Cell* cell;
+            size_t pos = m_popPos.load(std::memory_order_relaxed);
+            for (;;) {
+                cell = &m_cells[pos & m_mask];
+                size_t sequence = cell->m_sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(sequence) - intptr_t(pos + 1);
+                if (diff == 0) {
+                    if (m_popPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                    return false; // empty
+                else
+                    pos = m_popPos.load(std::memory_order_relaxed);
+            }
+            value = std::move(cell->m_data);
+            cell->m_sequence.store(pos + m_mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        inline size_t Capacity(void) const {
+            return m_mask + 1;
+        }
+
+        // approximate while other threads are pushing or popping
+        inline size_t Length(void) const {
+            size_t pushPos = m_pushPos.load(std::memory_order_relaxed);
+            size_t popPos = m_popPos.load(std::memory_order_relaxed);
+            return (pushPos > popPos) ? pushPos - popPos : 0;
+        }
+
+        inline bool IsEmpty(void) const {
+            return Length() == 0;
+        }
+};
+
+// =================================================================================================
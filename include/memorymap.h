@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#endif
+
+// =================================================================================================
+// Named shared memory object mapped into the address space (POSIX shm_open/mmap, Windows file
+// mappings). The creator owns the name and removes it again when closing.
+// OpenFile() maps a regular file read-only instead.
+
+class MemoryMap {
+    public:
+        void*       m_data;
+        size_t      m_size;
+        std::string m_name;
+        bool        m_isOwner;
+#ifdef _WIN32
+        HANDLE      m_handle;
+        HANDLE      m_file;
+#else
+        int         m_fd;
+#endif
+
+#ifdef _WIN32
+        MemoryMap() : m_data(nullptr), m_size(0), m_isOwner(false), m_handle(nullptr), m_file(INVALID_HANDLE_VALUE) {}
+#else
+        MemoryMap() : m_data(nullptr), m_size(0), m_isOwner(false), m_fd(-1) {}
+#endif
+
+        ~MemoryMap() {
+            Close();
+        }
+
+        MemoryMap(const MemoryMap&) = delete;
+
+        MemoryMap& operator=(const MemoryMap&) = delete;
+
+        // create a zero filled shared memory object of size bytes. Fails if an object of that name
+        // exists already; whether a leftover one may go is up to the caller (see Remove).
+        bool Create(const char* name, size_t size);
+
+        // remove the name of a shared memory object (POSIX; Windows objects disappear with their last handle)
+        static bool Remove(const char* name);
+
+        // map an existing shared memory object
+        bool Open(const char* name);
+
+        // map the whole file at path read-only. Fails for empty files.
+        bool OpenFile(const char* path);
+
+        void Close(void);
+
+        inline bool IsOpen(void) const {
+            return m_data != nullptr;
+        }
+
+        inline void* Data(void) const {
+            return m_data;
+        }
+
+        inline size_t Size(void) const {
+            return m_size;
+        }
+};
+
+// =================================================================================================
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <string>
+
+// =================================================================================================
+// Memory resources for the containers apptools owns (std::pmr). Classes that allocate per message
+// or per load (ReliableChannel, SendScheduler, TextFileLoader) take a std::pmr::memory_resource;
+// nullptr means std::pmr::get_default_resource(), i.e. the global heap unless changed.
+//   ArenaResource: monotonic arena for one-shot work (loading a config or text file). Freeing is
+//                  a no-op; everything goes at once with Release() or the arena's destruction.
+//   PoolResource:  size class pools for data that comes and goes (queued and unacknowledged
+//                  messages). The unshared variant has no locking and belongs to one thread, e.g.
+//                  one pool per network thread; isShared = true makes it safe for all threads.
+// Both count what they hand out (MemoryStats). All counting resources alive are listed by
+// MemoryResources::Report, the stats hook; MemoryResources::CountDefault additionally counts what
+// goes through the default resource.
+// String, List, ManagedArray and Dictionary (cpptools) take no allocator and stay on the heap.
+
+class MemoryStats {
+    public:
+        std::atomic<uint64_t>   m_allocations;
+        std::atomic<uint64_t>   m_deallocations;
+        std::atomic<uint64_t>   m_bytesAllocated;   // total over the lifetime
+        std::atomic<uint64_t>   m_bytesInUse;       // allocated and not freed yet
+        std::atomic<uint64_t>   m_peakBytes;        // high water mark of m_bytesInUse
+
+        MemoryStats() : m_allocations(0), m_deallocations(0), m_bytesAllocated(0), m_bytesInUse(0), m_peakBytes(0) {}
+
+        inline void Allocated(size_t bytes) {
+            m_allocations.fetch_add(1, std::memory_order_relaxed);
+            m_bytesAllocated.fetch_add(bytes, std::memory_order_relaxed);
+            uint64_t inUse = m_bytesInUse.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+            uint64_t peak = m_peakBytes.load(std::memory_order_relaxed);
+            while ((inUse > peak) and not m_peakBytes.compare_exchange_weak(peak, inUse, std::memory_order_relaxed))
+                ;
+        }
+
+        inline void Freed(size_t bytes) {
+            m_deallocations.fetch_add(1, std::memory_order_relaxed);
+            m_bytesInUse.fetch_sub(bytes, std::memory_order_relaxed);
+        }
+};
+
+// =================================================================================================
+// Passes allocations on to upstream and counts them.
+
+class CountingResource
+    : public std::pmr::memory_resource
+{
+    public:
+        const char*                 m_name;     // must outlive the resource
+        std::pmr::memory_resource*  m_upstream;
+        MemoryStats                 m_stats;
+
+        CountingResource(const char* name, std::pmr::memory_resource* upstream = nullptr);
+
+        ~CountingResource();
+
+        CountingResource(const CountingResource&) = delete;
+
+        CountingResource& operator=(const CountingResource&) = delete;
+
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+};
+
+// =================================================================================================
+
+class ArenaResource
+    : public CountingResource
+{
+    public:
+        std::pmr::monotonic_buffer_resource m_arena;
+
+        // the arena grows in blocks from upstream, starting with initialSize bytes
+        ArenaResource(const char* name, size_t initialSize = 64 * 1024, std::pmr::memory_resource* upstream = nullptr);
+
+        // the arena starts in buffer (e.g. on the stack) and only goes to upstream once it is full
+        ArenaResource(const char* name, void* buffer, size_t size, std::pmr::memory_resource* upstream = nullptr);
+
+        // free everything allocated from the arena at once
+        void Release(void);
+
+    protected:
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+};
+
+// =================================================================================================
+
+class PoolResource
+    : public CountingResource
+{
+    public:
+        std::unique_ptr<std::pmr::unsynchronized_pool_resource> m_localPool;
+        std::unique_ptr<std::pmr::synchronized_pool_resource>   m_sharedPool;
+
+        // blocks up to maxBlockSize bytes come from pools, bigger ones directly from upstream
+        PoolResource(const char* name, bool isShared = false, size_t maxBlockSize = 4096, std::pmr::memory_resource* upstream = nullptr);
+
+        // return the memory of all pools to upstream. Only call when nothing allocated from the pool is in use.
+        void Release(void);
+};
+
+// =================================================================================================
+
+class MemoryResources {
+    public:
+        typedef std::function<void(const CountingResource& resource)> tStatsHook;
+
+        // call hook for every counting resource alive
+        static void Report(tStatsHook hook);
+
+        // one line per counting resource
+        static std::string ToText(void);
+
+        // make the default resource count what passes through it (reported as "default").
+        // Call it at startup, before anything has allocated from the default resource.
+        static void CountDefault(void);
+
+    private:
+        friend class CountingResource;
+
+        static void Register(CountingResource* resource);
+
+        static void Unregister(CountingResource* resource);
+};
+
+// =================================================================================================
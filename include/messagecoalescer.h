@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+#include "string.hpp"
+#include "udp.h"
+
+// =================================================================================================
+// Sender side message aggregation. Messages queued for the same destination are packed into one
+// datagram (separated by UDP_MESSAGE_SEPARATOR) until it is full, the tick ends (Flush) or the oldest
+// message in it has waited maxDelay (Update). Receivers split them again with UDP::NextMessage,
+// so existing message handling code sees the individual messages. Messages containing the separator
+// can't be told apart from two messages and are rejected by Queue.
+
+#define UDP_HEADER_OVERHEAD 28 // IPv4 + UDP header bytes per datagram
+
+struct CoalescerParams {
+    uint16_t    maxDatagramSize = 1472; // prefix included; 1500 byte MTU minus IP and UDP headers avoids fragmentation.
+                                        // Clamped to UDP_MESSAGE_PREFIX_LENGTH + 1 .. UDP_MAX_DATAGRAM_SIZE.
+    int         maxDelay = 0;           // ms a message may wait for company; 0: only flush at tick end
+};
+
+
+class MessageCoalescer {
+    public:
+        typedef std::chrono::steady_clock tClock;
+
+        class Pending {
+            public:
+                UDPAddress          m_target;
+                uint16_t            m_length;
+                tClock::time_point  m_firstQueued;
+                uint8_t             m_data[UDP_MAX_DATAGRAM_SIZE];
+
+                Pending() : m_length(0) {}
+        };
+
+        UDP&                                    m_udp;
+        CoalescerParams                         m_params;
+        std::vector<Pending>                    m_pending;
+        std::unordered_map<uint64_t, size_t>    m_destinations; // UDPAddress key -> index in m_pending
+        // statistics
+        uint64_t                                m_messages;     // logical messages queued
+        uint64_t                                m_datagrams;    // datagrams handed to the socket
+        uint64_t                                m_payloadBytes; // message bytes without prefix and separators
+        uint64_t                                m_rejected;     // messages containing UDP_MESSAGE_SEPARATOR
+
+        MessageCoalescer(UDP& udp, const CoalescerParams& params = CoalescerParams())
+            : m_udp(udp), m_params(params), m_messages(0), m_datagrams(0), m_payloadBytes(0), m_rejected(0)
+        {
+            m_params.maxDatagramSize = std::clamp<uint16_t>(m_params.maxDatagramSize, UDP_MESSAGE_PREFIX_LENGTH + 1, UDP_MAX_DATAGRAM_SIZE);
+        }
+
+        inline bool Queue(const UDPPeer& peer, const String& message) {
+            return peer.IsValid() and Queue(peer.m_target, message.Data(), message.Length());
+        }
+
+        // false if message contains UDP_MESSAGE_SEPARATOR (not sent) or the send queue refused it
+        bool Queue(const UDPAddress& target, const char* message, size_t length);
+
+        // send everything pending (call at tick end)
+        int Flush(void);
+
+        // send the datagrams whose oldest message has waited maxDelay
+        int Update(void);
+
+        // share of the bytes on the wire that are message payload, with and without coalescing
+        inline float Efficiency(void) const {
+            return Efficiency(m_datagrams);
+        }
+
+        inline float UncoalescedEfficiency(void) const {
+            return Efficiency(m_messages);
+        }
+
+    private:
+        bool Close(Pending& pending);
+
+        inline float Efficiency(uint64_t datagrams) const {
+            uint64_t total = m_payloadBytes + datagrams * (UDP_HEADER_OVERHEAD + UDP_MESSAGE_PREFIX_LENGTH);
+            return total ? float(m_payloadBytes) / float(total) : 0.0f;
+        }
+};
+
+// =================================================================================================
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "networkmessage.h"
+#include "networkstats.h"
+
+// =================================================================================================
+// Keyword -> handler table. Keywords are hashed once when a handler is registered (FNV-1a; at
+// compile time for MessageKeyword constants declared constexpr), so dispatching a message costs one
+// hash of its keyword and a probe into an open addressing table, regardless of how many keywords
+// are registered. Each handler is registered with the value count IsValid() would check for it.
+// Messages with unknown keywords or wrong value counts are counted instead of reported; the ones
+// with wrong value counts also in the m_invalidMessages of the NetworkStats passed (e.g. the UDP's).
+// Handlers may register and unregister keywords (their own, too). While a message is being
+// dispatched such changes are deferred and applied once the outermost Dispatch() returns (or its
+// handler throws), so the running handler is never moved or destroyed and the table is never
+// resized under it.
+
+constexpr uint64_t KeywordHash(std::string_view keyword) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (char c : keyword)
+        hash = (hash ^ uint8_t(c)) * 0x100000001B3ull;
+    return hash;
+}
+
+
+class MessageKeyword {
+    public:
+        std::string_view    m_name;
+        uint64_t            m_hash;
+
+        constexpr MessageKeyword(const char* name) : m_name(name), m_hash(KeywordHash(name)) {}
+
+        constexpr MessageKeyword(std::string_view name) : m_name(name), m_hash(KeywordHash(name)) {}
+};
+
+
+class MessageDispatcher {
+    public:
+        typedef std::function<void(Message& message)> tHandler;
+
+        enum class tResult {
+            Handled,
+            Unknown,    // no handler registered for the keyword
+            Malformed   // wrong number of values
+        };
+
+        class Entry {
+            public:
+                uint64_t    m_hash;
+                std::string m_keyword;
+                int         m_valueCount;   // see Message::IsValid
+                tHandler    m_handler;
+                uint64_t    m_dispatched;
+
+                Entry() : m_hash(0), m_valueCount(0), m_dispatched(0) {}
+        };
+
+        // Register or Unregister called by a handler
+        class Change {
+            public:
+                uint64_t    m_hash;
+                std::string m_keyword;
+                bool        m_isRemoval;
+                int         m_valueCount;
+                tHandler    m_handler;
+        };
+
+        std::vector<Entry>  m_entries;  // capacity is a power of two and at least twice the number of keywords
+        size_t              m_count;
+        int                 m_dispatching;  // nesting depth of Dispatch calls
+        std::vector<Change> m_changes;      // deferred while dispatching
+        // statistics
+        uint64_t            m_dispatched;
+        uint64_t            m_unknown;
+        uint64_t            m_malformed;
+        NetworkStats*       m_stats;    // counts malformed messages in m_invalidMessages if set
+
+        MessageDispatcher(size_t capacity = 64, NetworkStats* stats = nullptr)
+            : m_count(0), m_dispatching(0), m_dispatched(0), m_unknown(0), m_malformed(0), m_stats(stats)
+        {
+            Resize(capacity);
+        }
+
+        // register (or replace) the handler for keyword
+        void Register(const MessageKeyword& keyword, int valueCount, tHandler handler);
+
+        // returns whether keyword was registered (while dispatching: is registered now; removed afterwards)
+        bool Unregister(const MessageKeyword& keyword);
+
+        // validate message against its keyword's value count and call the handler
+        tResult Dispatch(Message& message);
+
+        inline size_t Count(void) const {
+            return m_count;
+        }
+
+    private:
+        // counts the Dispatch nesting depth; leaving the outermost one applies the deferred changes, also when a handler throws
+        class DispatchScope {
+            public:
+                MessageDispatcher&  m_dispatcher;
+
+                DispatchScope(MessageDispatcher& dispatcher) : m_dispatcher(dispatcher) {
+                    ++m_dispatcher.m_dispatching;
+                }
+
+                ~DispatchScope();
+        };
+
+        // slot holding keyword, or the empty slot where it would go
+        size_t Find(uint64_t hash, std::string_view keyword) const;
+
+        void Resize(size_t capacity);
+
+        void Insert(uint64_t hash, std::string_view keyword, int valueCount, tHandler handler);
+
+        bool Remove(uint64_t hash, std::string_view keyword);
+
+        void ApplyChanges(void);
+};
+
+// =================================================================================================
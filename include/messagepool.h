@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "lockfreequeue.h"
+#include "networkmessage.h"
+
+// =================================================================================================
+// Pool of recyclable messages, each with its own MessageArena. Acquire() hands out a PooledMessage
+// which returns the message to the pool when it goes out of scope. The free list is a lock-free queue,
+// so messages can be acquired on the network thread and released on the game thread.
+// Once the pool has grown to the working set, receiving messages doesn't allocate anymore.
+
+class MessagePool;
+
+class PooledMessage {
+    public:
+        Message*        m_message;
+        MessagePool*    m_pool;
+
+        PooledMessage() : m_message(nullptr), m_pool(nullptr) {}
+
+        PooledMessage(Message* message, MessagePool* pool) : m_message(message), m_pool(pool) {}
+
+        PooledMessage(const PooledMessage&) = delete;
+
+        PooledMessage& operator=(const PooledMessage&) = delete;
+
+        PooledMessage(PooledMessage&& other) noexcept : m_message(other.m_message), m_pool(other.m_pool) {
+            other.m_message = nullptr;
+        }
+
+        PooledMessage& operator=(PooledMessage&& other) noexcept {
+            if (this != &other) {
+                Release();
+                m_message = other.m_message;
+                m_pool = other.m_pool;
+                other.m_message = nullptr;
+            }
+            return *this;
+        }
+
+        ~PooledMessage() {
+            Release();
+        }
+
+        // return the message to its pool
+        void Release(void);
+
+        inline explicit operator bool() const {
+            return m_message != nullptr;
+        }
+
+        inline Message* operator->() const {
+            return m_message;
+        }
+
+        inline Message& operator*() const {
+            return *m_message;
+        }
+};
+
+// =================================================================================================
+
+class MessagePool {
+    private:
+        struct Entry {
+            MessageArena    m_arena;
+            Message         m_message;
+
+            Entry() : m_message(&m_arena) {}
+        };
+
+        LockFreeQueue<Message*>                 m_free;
+        std::vector<std::unique_ptr<Entry[]>>   m_blocks;
+        std::mutex                              m_growLock;
+        size_t                                  m_blockSize;
+        size_t                                  m_maxSize;
+
+    public:
+        // statistics
+        std::atomic<uint64_t>   m_size;         // messages created
+        std::atomic<uint64_t>   m_acquired;
+        std::atomic<uint64_t>   m_exhausted;    // Acquire calls that found the pool empty at maximum size
+
+        // size messages are created up front; the pool grows in steps of size up to maxSize messages
+        MessagePool(size_t size = 256, size_t maxSize = 4096);
+
+        PooledMessage Acquire(void);
+
+        void Release(Message* message);
+
+        inline size_t Available(void) const {
+            return m_free.Length();
+        }
+
+    private:
+        bool Grow(void);
+};
+
+// =================================================================================================
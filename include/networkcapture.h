@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+
+#include "memorymap.h"
+#include "udpdatagram.h"
+
+// =================================================================================================
+// Capture files of UDP traffic for load testing. CaptureRecorder logs datagrams as they are sent or
+// received; CaptureReplay maps a capture file and hands its datagrams to UDP's receive path in place
+// of the socket (see UDP::Replay), at their original pace or as fast as possible.
+//
+// File layout (little endian):
+//   header: "SMCAP\0" <version:u16> <start time:u64, µs since 1970>
+//   record: <time:u64, ns since capture start> <host:u32> <port:u16> <length:u16> <datagram bytes>
+// Host and port are stored the way UDPAddress holds them (network byte order). The top bit of
+// length marks sent datagrams; their address is the destination, otherwise it is the sender.
+// Records are not padded.
+
+#define CAPTURE_MAGIC           "SMCAP"
+#define CAPTURE_VERSION         1
+#define CAPTURE_HEADER_SIZE     16
+#define CAPTURE_RECORD_SIZE     16
+#define CAPTURE_SENT_FLAG       0x8000
+
+class CaptureRecorder {
+    public:
+        typedef std::chrono::steady_clock tClock;
+
+        FILE*               m_file;
+        tClock::time_point  m_start;
+        mutable std::mutex  m_lock;     // guards m_file; send and receive paths may run on different threads
+        // statistics
+        uint64_t            m_records;
+        uint64_t            m_bytes;
+
+        CaptureRecorder() : m_file(nullptr), m_records(0), m_bytes(0) {}
+
+        ~CaptureRecorder() {
+            Close();
+        }
+
+        CaptureRecorder(const CaptureRecorder&) = delete;
+
+        CaptureRecorder& operator=(const CaptureRecorder&) = delete;
+
+        bool Open(const char* fileName);
+
+        void Close(void);
+
+        inline bool IsOpen(void) const {
+            std::lock_guard<std::mutex> lock(m_lock);
+            return m_file != nullptr;
+        }
+
+        // log a datagram consisting of prefix and data (sent datagrams are gathered from both like on the wire)
+        void Record(bool sent, const UDPAddress& address, const char* prefix, size_t prefixLength, const char* data, size_t length);
+
+        inline void Record(const UDPDatagram& datagram) {
+            Record(false, datagram.m_address, nullptr, 0, datagram.Data(), datagram.m_length);
+        }
+};
+
+// =================================================================================================
+
+struct ReplayParams {
+    float   speed = 1.0f;       // time scale of the original timing; 0: as fast as possible
+    bool    loop = false;       // start over at the end of the capture
+    bool    includeSent = false;// also replay the datagrams the recording side sent
+};
+
+
+class CaptureReplay {
+    public:
+        typedef std::chrono::steady_clock tClock;
+
+        MemoryMap           m_map;
+        ReplayParams        m_params;
+        size_t              m_offset;       // read position in the mapped file
+        uint64_t            m_startTime;    // record time stamp the replay started at
+        tClock::time_point  m_start;
+        // statistics
+        uint64_t            m_replayed;
+        uint64_t            m_loops;
+
+        CaptureReplay() : m_offset(0), m_startTime(0), m_replayed(0), m_loops(0) {}
+
+        bool Open(const char* fileName, const ReplayParams& params = ReplayParams());
+
+        void Close(void);
+
+        inline bool IsOpen(void) const {
+            return m_map.IsOpen();
+        }
+
+        // true when the whole capture has been replayed (never when looping)
+        inline bool IsFinished(void) const {
+            return m_offset >= m_map.Size();
+        }
+
+        // next datagram that is due. Returns false if there is none yet (or no more).
+        bool Next(UDPDatagram& datagram);
+
+        // move due datagrams into the free slots of ring
+        int ReceiveBatch(UDPDatagramRing& ring);
+
+        // wall clock time the capture was started (µs since 1970)
+        uint64_t RecordingTime(void) const;
+
+    private:
+        void Rewind(void);
+};
+
+// =================================================================================================
@@ -1,10 +1,35 @@
 #pragma once 
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string_view>
 
 #include "string.hpp"
 #include "list.hpp"
 #include "vector.hpp"
+#include "udpdatagram.h"
+
+// =================================================================================================
+// Fixed storage for pooled messages (see MessagePool). Payload, sender address and the value
+// positions live in here instead of in Strings, so receiving into a pooled message doesn't allocate.
+// Values aren't copied; the arena records where each one starts in the payload and how long it is.
+
+#define MESSAGE_MAX_VALUES 64
+
+class MessageArena {
+    public:
+        char        m_payload[UDP_MAX_DATAGRAM_SIZE + 1];
+        uint16_t    m_length;
+        char        m_address[16];
+        uint16_t    m_valueOffsets[MESSAGE_MAX_VALUES];
+        uint16_t    m_valueLengths[MESSAGE_MAX_VALUES];
+        uint64_t    m_receiveTime;  // NetworkStats::Now() when the datagram was drained, 0: unknown
+
+        MessageArena() : m_length(0), m_receiveTime(0) {
+            m_payload[0] = '\0';
+            m_address[0] = '\0';
+        }
+};
 
 // =================================================================================================
 // network data and address
@@ -26,7 +51,13 @@ class Message {
         numValues:
             Number of values
         result:
-            Result of message processing (test for keyword match and required (minimum) number of values)
+            Result of message processing (test for keyword match and required (minimum) number of values):
+            0: not split yet, 2: split, value count not checked, 1: valid, -1: wrong value count,
+            -2: malformed (too many values for the arena). The payload is split only once, so later
+            checks (e.g. on the game thread after NetworkThread's preParse) only compare the value count.
+        arena:
+            Fixed storage of a pooled message. If set, payload, address and values are kept there
+            instead of in payload, address and values.
 
     Methods:
     --------
@@ -41,8 +72,11 @@ class Message {
         size_t         m_numValues;
         int            m_result;
         ManagedArray<String>    m_values;
+        MessageArena*           m_arena;
 
-        Message() : m_numValues (0), m_port (0), m_result (0) {}
+        Message() : m_port (0), m_numValues (0), m_result (0), m_arena (nullptr) {}
+
+        Message(MessageArena* arena) : m_port (0), m_numValues (0), m_result (0), m_arena (arena) {}
 
         Message(String message, String address, uint16_t port) {
             /*
@@ -62,15 +96,68 @@ class Message {
             m_port = port;
             m_numValues = 0;
             m_result = 0;
+            m_arena = nullptr;
+        }
+
+        // copying or moving a pooled message into a plain one turns the arena contents into Strings,
+        // so the copy stays valid after the pooled message has been recycled
+        Message(const Message& other) : m_arena(nullptr) {
+            Copy(other);
+        }
+
+        // not noexcept: moving from or into a pooled message copies (see Move)
+        Message(Message&& other) : m_arena(nullptr) {
+            Move(other);
+        }
+
+        Message& operator= (const Message& other) {
+            return Copy(other);
+        }
+
+        Message& operator= (Message&& other) {
+            return Move(other);
         }
 
+        Message& Copy(const Message& other);
+
+        Message& Move(Message& other);
+
+        // set payload and sender. Pooled messages copy them into their arena.
+        void Assign(const char* payload, size_t length, const char* address, uint16_t port);
+
+        // forget payload and values, keeping the arena
+        void Reset(void);
 
-        bool IsEmpty(void) {
-            return m_payload.IsEmpty();
+        bool IsEmpty(void) const {
+            return m_arena ? (m_arena->m_length == 0) : m_payload.IsEmpty();
         }
 
         bool IsValid(int valueCount = 0);
 
+        // IsValid without the error report (see MessageDispatcher, which counts bad messages instead)
+        bool Validate(int valueCount = 0);
+
+        // split the values unless that has been done already; false if the message is malformed
+        bool Split(void);
+
+        inline const char* Payload(void) const {
+            return m_arena ? m_arena->m_payload : m_payload.Data();
+        }
+
+        inline size_t PayloadLength(void) const {
+            return m_arena ? m_arena->m_length : m_payload.Length();
+        }
+
+        inline const char* Address(void) const {
+            return m_arena ? m_arena->m_address : m_address.Data();
+        }
+
+        // message keyword (text in front of '#')
+        std::string_view Keyword(void) const;
+
+        // i-th value without creating a String
+        std::string_view Value(int i);
+
 
         inline String ToStr(int i) {
             /*
@@ -80,6 +167,10 @@ class Message {
             -----------
                 i: Index of the requested parameter
             */
+            if (m_arena) {
+                std::string_view v = Value(i);
+                return String(v.data(), v.length());
+            }
             return m_values[i];
         }
 
@@ -93,6 +184,8 @@ class Message {
             -----------
                 i: Index of the requested parameter
             */
+            if (m_arena)
+                return int(strtol(Value(i).data(), nullptr, 10));
             return int(m_values[i]);
         }
 
@@ -105,6 +198,8 @@ class Message {
             -----------
                 i: Index of the requested parameter
             */
+            if (m_arena)
+                return strtof(Value(i).data(), nullptr);
             return float(m_values[i]);
         }
 
@@ -118,6 +213,14 @@ class Message {
             -----------
                 i: Index of the requested parameter
             */
+            if (m_arena) {
+                // values end at ';' or the end of the payload, both of which stop strtof
+                char* s = const_cast<char*>(Value(i).data());
+                float x = strtof(s, &s);
+                float y = strtof(s + (*s == ','), &s);
+                float z = strtof(s + (*s == ','), &s);
+                return Vector3f{ x, y, z };
+            }
             ManagedArray<String> coords = m_values[i].Split(',');
             return Vector3f{ float(coords[0]), float(coords[1]), float(coords[2]) };
         }
@@ -134,10 +237,25 @@ class Message {
             -----------
                 i: Index of the requested parameter
             */
+            if (m_arena) {
+                std::string_view v = Value(i);
+                size_t l = v.find(':');
+                if (l == std::string_view::npos)
+                    l = v.length();
+                port = (l < v.length()) ? uint16_t(strtol(v.data() + l + 1, nullptr, 10)) : 0;
+                return String(v.data(), l);
+            }
             ManagedArray<String> values = m_values[i].Split(':');
             port = uint16_t(values[1]);
             return values[0];
         }
+
+    private:
+        // split the payload into keyword and values (plain messages: into m_values, pooled messages: into
+        // the arena). Returns false if a pooled message has more than MESSAGE_MAX_VALUES values; it then has none.
+        bool Parse(void);
+
+        bool ParseArena(void);
 };
 
 // =================================================================================================
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "udpdatagram.h"
+
+// =================================================================================================
+// Networking statistics. Everything is a relaxed atomic, so the network path never waits for a
+// reader and any thread can take a snapshot (ToText, ToJSON) while traffic goes on. A snapshot is
+// not a consistent cut: counters read a few microseconds apart may disagree slightly.
+
+class TrafficCounters {
+    public:
+        std::atomic<uint64_t>   m_packetsIn;
+        std::atomic<uint64_t>   m_bytesIn;
+        std::atomic<uint64_t>   m_packetsOut;
+        std::atomic<uint64_t>   m_bytesOut;
+        std::atomic<uint64_t>   m_sendFailures;
+
+        TrafficCounters() : m_packetsIn(0), m_bytesIn(0), m_packetsOut(0), m_bytesOut(0), m_sendFailures(0) {}
+
+        inline void Received(size_t bytes, uint64_t packets = 1) {
+            m_packetsIn.fetch_add(packets, std::memory_order_relaxed);
+            m_bytesIn.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        inline void Sent(size_t bytes, uint64_t packets = 1) {
+            m_packetsOut.fetch_add(packets, std::memory_order_relaxed);
+            m_bytesOut.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        inline void SendFailed(uint64_t packets = 1) {
+            m_sendFailures.fetch_add(packets, std::memory_order_relaxed);
+        }
+
+        void Export(std::string& text, bool json) const;
+};
+
+// =================================================================================================
+// Current value and high water mark (queue depths)
+
+class Gauge {
+    public:
+        std::atomic<uint64_t>   m_value;
+        std::atomic<uint64_t>   m_max;
+
+        Gauge() : m_value(0), m_max(0) {}
+
+        inline void Set(uint64_t value) {
+            m_value.store(value, std::memory_order_relaxed);
+            uint64_t max = m_max.load(std::memory_order_relaxed);
+            while ((value > max) and not m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+                ;
+        }
+
+        inline uint64_t Value(void) const {
+            return m_value.load(std::memory_order_relaxed);
+        }
+
+        inline uint64_t Max(void) const {
+            return m_max.load(std::memory_order_relaxed);
+        }
+};
+
+// =================================================================================================
+// HDR style histogram of microsecond values: every power of two range is split into 16 linear
+// sub buckets, so any recorded value is known to within 1/16 (6.25%) over the whole range
+// (0 µs .. 2^32 µs) with a fixed 464 counters.
+
+class LatencyHistogram {
+    public:
+        static constexpr int subBits = 4;
+        static constexpr int subCount = 1 << subBits;
+        static constexpr int maxBits = 32;
+        static constexpr int bucketCount = (maxBits - subBits + 1) * subCount;
+
+        std::atomic<uint64_t>   m_counts[bucketCount];
+        std::atomic<uint64_t>   m_count;
+        std::atomic<uint64_t>   m_sum;
+        std::atomic<uint64_t>   m_max;
+
+        LatencyHistogram() : m_counts{}, m_count(0), m_sum(0), m_max(0) {}
+
+        static inline int Index(uint64_t value) {
+            if (value < uint64_t(subCount))
+                return int(value);
+            int msb = 63;
+            while (not (value >> msb))
+                --msb;
+            if (msb >= maxBits)
+                return bucketCount - 1;
+            int shift = msb - subBits;
+            return (shift + 1) * subCount + int(value >> shift) - subCount;
+        }
+
+        // smallest value that falls into bucket i
+        static inline uint64_t LowerBound(int i) {
+            if (i < subCount)
+                return uint64_t(i);
+            int shift = i / subCount - 1;
+            return uint64_t(i % subCount + subCount) << shift;
+        }
+
+        inline void Record(uint64_t value) {
+            m_counts[Index(value)].fetch_add(1, std::memory_order_relaxed);
+            m_count.fetch_add(1, std::memory_order_relaxed);
+            m_sum.fetch_add(value, std::memory_order_relaxed);
+            uint64_t max = m_max.load(std::memory_order_relaxed);
+            while ((value > max) and not m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+                ;
+        }
+
+        inline uint64_t Count(void) const {
+            return m_count.load(std::memory_order_relaxed);
+        }
+
+        inline double Mean(void) const {
+            uint64_t n = Count();
+            return n ? double(m_sum.load(std::memory_order_relaxed)) / double(n) : 0.0;
+        }
+
+        inline uint64_t Max(void) const {
+            return m_max.load(std::memory_order_relaxed);
+        }
+
+        // value below which share (0..1) of the recorded values lie (bucket midpoint)
+        uint64_t Percentile(double share) const;
+
+        void Export(std::string& text, bool json) const;
+};
+
+// =================================================================================================
+// Per-peer statistics. Peers are keyed by the address seen on the wire, so a peer that sends from
+// another port than it listens on shows up twice (once with its traffic in, once with traffic out).
+
+class PeerStats : public TrafficCounters {
+    public:
+        std::atomic<uint64_t>   m_key;  // UDPAddress key
+        LatencyHistogram        m_rtt;
+
+        PeerStats() : m_key(0) {}
+};
+
+
+// A peer's statistics (about 4 KB with the histogram) are allocated when the peer is first seen,
+// so a UDP instance that talks to few peers doesn't carry maxPeers of them.
+
+class NetworkStats {
+    public:
+        static constexpr uint32_t maxPeers = 128;   // power of two; peers beyond that are counted in m_otherPeers
+
+        const TrafficCounters*  m_sockets[2];       // UDP receive and send socket
+        std::atomic<uint64_t>   m_peerKeys[maxPeers];   // UDPAddress key of the peer in the slot, 0: free
+        std::atomic<PeerStats*> m_peers[maxPeers];      // nullptr until the slot's peer has been seen
+        PeerStats               m_otherPeers;
+        std::atomic<uint64_t>   m_prefixMismatches; // datagrams without message prefix
+        std::atomic<uint64_t>   m_invalidMessages;  // messages failing the value count check (counted by MessageDispatcher)
+        Gauge                   m_sendQueue;
+        Gauge                   m_inQueue;          // NetworkThread queues
+        Gauge                   m_outQueue;
+        LatencyHistogram        m_dispatchLatency;  // µs from draining the socket to the game thread picking the message up
+        LatencyHistogram        m_rtt;              // µs, all peers
+
+        NetworkStats() : m_sockets{}, m_peerKeys{}, m_peers{}, m_prefixMismatches(0), m_invalidMessages(0) {}
+
+        ~NetworkStats() {
+            for (auto& peer : m_peers)
+                delete peer.load(std::memory_order_relaxed);
+        }
+
+        NetworkStats(const NetworkStats&) = delete;
+
+        NetworkStats& operator=(const NetworkStats&) = delete;
+
+        // statistics of peer; inserts the peer on first use without locking
+        PeerStats& Peer(const UDPAddress& address);
+
+        // steady clock time stamp in µs for latency measurements
+        static inline uint64_t Now(void) {
+            return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        std::string ToText(void) const;
+
+        std::string ToJSON(void) const;
+
+    private:
+        PeerStats& Slot(uint32_t i, uint64_t key);
+
+        std::string Export(bool json) const;
+};
+
+// =================================================================================================
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+#include "string.hpp"
+#include "lockfreequeue.h"
+#include "messagepool.h"
+#include "networkmessage.h"
+#include "udp.h"
+
+// =================================================================================================
+// Threaded networking mode: a background I/O thread owns the UDP sockets. It drains the receive
+// socket, converts and pre-parses the datagrams into pooled Messages and hands them to the game
+// thread through a bounded lock-free queue. Outgoing messages take the opposite way and are sent in
+// one batch per I/O loop. While the thread runs, the game thread must only use Receive() and Transmit().
+
+enum class BackpressurePolicy {
+    DropNewest,     // discard the message that doesn't fit anymore
+    DropOldest,     // discard the oldest queued message to make room
+    Block           // wait until the other side has made room
+};
+
+
+struct NetworkThreadParams {
+    uint32_t            inQueueSize = 1024;
+    uint32_t            outQueueSize = 1024;
+    BackpressurePolicy  inPolicy = BackpressurePolicy::DropOldest;  // the game wants the latest state
+    BackpressurePolicy  outPolicy = BackpressurePolicy::Block;      // don't silently lose what the game sends
+    uint32_t            ringSize = 256;     // datagram slots drained per I/O loop
+    uint32_t            poolSize = 256;     // messages preallocated in the message pool (grows up to the total queue size)
+    int                 idleWait = 500;     // microseconds the I/O thread sleeps when there was nothing to do
+    bool                preParse = true;    // split the message values on the I/O thread
+};
+
+
+class OutgoingMessage {
+    public:
+        UDPAddress      m_target;
+        PooledMessage   m_message;
+};
+
+
+class NetworkThread {
+    public:
+        UDP&                            m_udp;
+        NetworkThreadParams             m_params;
+        MessagePool                     m_pool;
+        LockFreeQueue<PooledMessage>    m_inQueue;
+        LockFreeQueue<OutgoingMessage>  m_outQueue;
+        std::thread                     m_thread;
+        std::atomic<bool>               m_isRunning;
+        // statistics
+        std::atomic<uint64_t>           m_received;
+        std::atomic<uint64_t>           m_sent;
+        std::atomic<uint64_t>           m_droppedIn;
+        std::atomic<uint64_t>           m_droppedOut;
+        // queue depths and dispatch latency are kept in m_udp.m_stats
+
+        NetworkThread(UDP& udp, const NetworkThreadParams& params = NetworkThreadParams());
+
+        ~NetworkThread() {
+            Stop();
+        }
+
+        bool Start(void);
+
+        void Stop(void);
+
+        // game thread side
+        bool Receive(PooledMessage& message);
+
+        // copies the message out of the pool
+        bool Receive(Message& message);
+
+        bool Transmit(const UDPPeer& peer, const String& message);
+
+        inline size_t InQueueDepth(void) const {
+            return m_inQueue.Length();
+        }
+
+        inline size_t OutQueueDepth(void) const {
+            return m_outQueue.Length();
+        }
+
+    private:
+        template <typename T, typename V>
+        bool Enqueue(LockFreeQueue<T>& queue, V&& item, BackpressurePolicy policy, std::atomic<uint64_t>& dropped, Gauge& depth);
+
+        int ProcessIncoming(UDPDatagramRing& ring);
+
+        int ProcessOutgoing(void);
+
+        void Run(void);
+};
+
+// =================================================================================================
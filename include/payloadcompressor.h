@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// =================================================================================================
+// Fast compression for datagram payloads: an LZ4 style block coder (literal runs and back references
+// of at least 4 bytes with 16 bit offsets) with a preset dictionary. The dictionary counts as data
+// preceding every payload, so even a short message can refer to keywords and values seen in typical
+// traffic. Sender and receiver must use the same dictionary; its id travels with each payload, so a
+// mismatch is detected instead of producing garbage.
+//
+// Compressed layout: <dictionary id:u8> <raw length:u16, little endian> <sequences>
+//   sequence: <token: literal count (high nibble), match length - 4 (low nibble)>
+//             [literal count - 15 as runs of 255 and a final byte < 255] <literals>
+//             <match offset:u16, little endian> [match length - 19 as above]
+//   The last sequence only has literals.
+
+#define COMPRESSION_DICTIONARY_SIZE 1024
+#define COMPRESSION_HASH_BITS       12
+#define COMPRESSION_HEADER_SIZE     3
+#define COMPRESSION_MIN_MATCH       4
+
+class PayloadCompressor {
+    public:
+        uint8_t     m_dictionary[COMPRESSION_DICTIONARY_SIZE];
+        uint16_t    m_dictionaryLength;
+        uint8_t     m_dictionaryId;     // 0: no dictionary
+        uint16_t    m_dictionaryTable[1 << COMPRESSION_HASH_BITS];  // hash of 4 bytes -> dictionary position + 1, 0: empty
+        bool        m_isEnabled;
+        uint16_t    m_minLength;        // shorter payloads are sent as they are
+        // statistics (sending and receiving side)
+        uint64_t    m_compressed;       // payloads sent compressed
+        uint64_t    m_skipped;          // payloads long enough that didn't get smaller
+        uint64_t    m_rawBytes;         // size of the compressed payloads before compression
+        uint64_t    m_compressedBytes;  // and after
+        uint64_t    m_expanded;
+        uint64_t    m_failures;         // corrupt payloads or dictionary mismatches
+
+        PayloadCompressor();
+
+        // compress payloads of at least minLength bytes when sending (receiving always decompresses)
+        inline void Enable(bool enable = true, uint16_t minLength = 64) {
+            m_isEnabled = enable;
+            m_minLength = minLength;
+        }
+
+        // use the last COMPRESSION_DICTIONARY_SIZE bytes of data as dictionary (length 0: none)
+        void SetDictionary(const char* data, size_t length);
+
+        // build a dictionary from sample messages: their most frequent keywords and values
+        void Train(const std::vector<std::string>& samples);
+
+        // compress data into output; returns the compressed length or 0 if that isn't shorter than capacity
+        size_t Compress(const uint8_t* data, size_t length, uint8_t* output, size_t capacity);
+
+        // decompress a payload produced by Compress; returns the original length or -1 if it is corrupt,
+        // doesn't fit into capacity or was made with another dictionary. output may overlap data.
+        int Expand(const uint8_t* data, size_t length, uint8_t* output, size_t capacity);
+
+        // compressed size relative to the original size of what was sent compressed
+        inline float Ratio(void) const {
+            return m_rawBytes ? float(m_compressedBytes) / float(m_rawBytes) : 1.0f;
+        }
+
+    private:
+        static inline uint32_t Hash(const uint8_t* p) {
+            uint32_t v;
+            memcpy(&v, p, sizeof(v));
+            return (v * 2654435761u) >> (32 - COMPRESSION_HASH_BITS);
+        }
+};
+
+// =================================================================================================
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory_resource>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include "string.hpp"
+#include "networkmessage.h"
+#include "udp.h"
+
+// =================================================================================================
+// Optional reliable and ordered delivery on top of UDP. Messages sent with Transmit() are
+// unreliable as before. Messages sent with TransmitReliable() get a sequence number and are kept
+// until the peer acknowledges them. Acks are piggybacked on reliable traffic in the other direction
+// (newest sequence received + bit field for the 32 sequences before it) and only sent separately
+// when there is nothing to piggyback on by the end of the tick. Messages not acknowledged within
+// the retransmission timeout (derived from the measured round trip time) are resent individually,
+// as are messages the peer's acks show as missing while three newer ones already arrived.
+// Ordered messages are only delivered once all reliable messages before them have been delivered.
+//
+// Wire format (numbers in hex except the port):
+//   data: @rel#<port>:<o|u>:<seq>:<ack>:<ack bits>;<original message>
+//   ack:  @rack#<port>:<ack>:<ack bits>
+// <port> is the sender's receive port (datagrams come from its send socket), so replies find their way back.
+// Peer state and message copies are allocated from the memory resource passed to the constructor
+// (e.g. a PoolResource owned by the thread running the channel).
+
+struct ReliableParams {
+    int         initialRTO = 200;   // ms until the first resend before an RTT has been measured
+    int         minRTO = 30;        // ms
+    int         maxRTO = 2000;      // ms
+    uint32_t    windowSize = 256;   // max. unacknowledged messages per peer; TransmitReliable fails beyond that
+};
+
+
+class ReliableChannel {
+    public:
+        typedef std::chrono::steady_clock tClock;
+
+        class Outgoing {
+            public:
+                uint32_t            m_sequence;
+                bool                m_ordered;
+                bool                m_fastResent;
+                int                 m_transmissions;
+                tClock::time_point  m_lastSent;
+                std::pmr::string    m_data;     // original message without header
+
+                Outgoing(std::pmr::memory_resource* resource) : m_data(resource) {}
+        };
+
+        class PeerState {
+            public:
+                UDPPeer                         m_replyPeer;
+                // sending
+                uint32_t                        m_nextSequence;
+                std::pmr::deque<Outgoing>       m_unacked;      // ascending sequence numbers
+                // receiving
+                uint32_t                        m_lastReceived;     // newest sequence received
+                uint32_t                        m_nextExpected;     // all sequences before it have been received
+                std::pmr::set<uint32_t>         m_receivedAhead;    // received sequences >= m_nextExpected
+                std::pmr::map<uint32_t, std::pmr::string> m_heldBack;   // ordered messages waiting for a gap to fill
+                bool                            m_ackPending;
+                // round trip time (RFC 6298)
+                float                           m_srtt;
+                float                           m_rttVar;
+                int                             m_rto;
+                // statistics
+                uint64_t                        m_sent;
+                uint64_t                        m_resent;
+                uint64_t                        m_acked;
+                uint64_t                        m_duplicates;
+
+                PeerState(int rto, std::pmr::memory_resource* resource)
+                    : m_nextSequence(1), m_unacked(resource), m_lastReceived(0), m_nextExpected(1), m_receivedAhead(resource), m_heldBack(resource), m_ackPending(false),
+                      m_srtt(0.0f), m_rttVar(0.0f), m_rto(rto), m_sent(0), m_resent(0), m_acked(0), m_duplicates(0)
+                { }
+
+                inline bool HasReceived(uint32_t sequence) const {
+                    return (int32_t(sequence - m_nextExpected) < 0) or (m_receivedAhead.count(sequence) > 0);
+                }
+        };
+
+        enum class tResult {
+            Passed,     // no channel message, unchanged
+            Delivered,  // header stripped, message ready for the application
+            Consumed    // ack, duplicate or held back ordered message
+        };
+
+        class Delivery {
+            public:
+                std::pmr::string    m_data;
+                char                m_address[16];
+                uint16_t            m_port;
+
+                Delivery(std::pmr::memory_resource* resource) : m_data(resource) {}
+        };
+
+        UDP&                                            m_udp;
+        ReliableParams                                  m_params;
+        std::pmr::memory_resource*                      m_resource;
+        std::pmr::unordered_map<uint64_t, PeerState>    m_peers;    // UDPAddress key (host + receive port) -> state
+        std::pmr::deque<Delivery>                       m_ready;    // released ordered messages
+
+        // resource: where peer state and queued messages live; nullptr: the default resource
+        ReliableChannel(UDP& udp, const ReliableParams& params = ReliableParams(), std::pmr::memory_resource* resource = nullptr)
+            : m_udp(udp), m_params(params), m_resource(resource ? resource : std::pmr::get_default_resource()), m_peers(m_resource), m_ready(m_resource)
+        { }
+
+        // unreliable fast path
+        inline bool Transmit(const UDPPeer& peer, const String& message) {
+            return m_udp.Transmit(peer, message);
+        }
+
+        // longest message TransmitReliable accepts: a datagram minus prefix and the longest header
+        static constexpr size_t maxHeaderLength = 40;   // "@rel#65535:o:ffffffff:ffffffff:ffffffff;"
+        static constexpr size_t maxMessageLength = UDP_MAX_DATAGRAM_SIZE - UDP_MESSAGE_PREFIX_LENGTH - maxHeaderLength;
+
+        // returns false (and nothing is queued) if peer is invalid, the window is full or message is
+        // longer than maxMessageLength. Once queued, a message is delivered eventually even if the
+        // first send fails; that counts as loss and is retransmitted.
+        bool TransmitReliable(const UDPPeer& peer, const String& message, bool ordered = true);
+
+        // receive the next application message, handling acks, duplicates and ordering on the way
+        bool Receive(Message& message);
+
+        tResult Decode(Message& message);
+
+        // resend overdue messages and send acks that couldn't be piggybacked (call once per tick)
+        int Update(void);
+
+        // smoothed round trip time in ms, 0 if not measured yet
+        float RoundTripTime(const UDPPeer& peer);
+
+        uint32_t Unacknowledged(const UDPPeer& peer);
+
+    private:
+        PeerState& Peer(uint64_t key);
+
+        bool Send(PeerState& peer, Outgoing& message);
+
+        void Acknowledge(PeerState& peer, uint32_t ack, uint32_t bits);
+
+        void UpdateRTT(PeerState& peer, float rtt);
+
+        void Received(PeerState& peer, uint32_t sequence);
+
+        uint32_t AckBits(const PeerState& peer) const;
+};
+
+// =================================================================================================
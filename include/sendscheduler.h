@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "string.hpp"
+#include "udp.h"
+
+// =================================================================================================
+// Paced sending. Messages are queued per peer and priority class instead of being sent right away;
+// Update() (call it often, e.g. every loop iteration) sends them:
+// - most important class first, oldest message first within a class
+// - within each peer's token bucket (bytes per second with a burst allowance)
+// - state and chat messages spread evenly across the tick instead of in one burst (input isn't paced)
+// - messages older than their class's maxAge are dropped; state messages queued with merge = true
+//   replace a queued message for the same entity (keyword and first value) instead of queueing up
+// Queued messages are allocated from the memory resource passed to the constructor.
+
+enum class SendPriority {
+    Input = 0,
+    State = 1,
+    Chat = 2
+};
+
+#define SEND_PRIORITY_CLASSES 3
+
+struct SendSchedulerParams {
+    uint32_t    bytesPerSecond = 64 * 1024;         // per peer
+    uint32_t    burstBytes = 8 * 1024;              // token bucket size; larger messages wait for a full bucket
+    int         tickInterval = 16;                  // ms to spread each tick's paced messages over
+    int         maxAge[SEND_PRIORITY_CLASSES] = { 0, 100, 2000 };  // ms until a queued message is dropped; 0: never
+    uint32_t    maxQueued = 256;                    // per peer and class; the oldest message is dropped beyond that
+};
+
+
+class SendScheduler {
+    public:
+        typedef std::chrono::steady_clock tClock;
+
+        class Pending {
+            public:
+                std::pmr::string    m_data;
+                std::pmr::string    m_key;      // merge key, empty if not mergeable
+                tClock::time_point  m_queued;
+
+                Pending(std::pmr::memory_resource* resource) : m_data(resource), m_key(resource) {}
+        };
+
+        class ClassQueue {
+            public:
+                std::pmr::deque<Pending>                            m_messages;
+                uint64_t                                            m_firstSequence;    // sequence number of m_messages.front()
+                std::pmr::unordered_map<std::pmr::string, uint64_t> m_keys;             // merge key -> sequence number
+
+                ClassQueue(std::pmr::memory_resource* resource) : m_messages(resource), m_firstSequence(0), m_keys(resource) {}
+
+                void PopFront(void);
+        };
+
+        class PeerQueue {
+            public:
+                UDPPeer             m_peer;
+                double              m_tokens;
+                tClock::time_point  m_lastRefill;
+                ClassQueue          m_classes[SEND_PRIORITY_CLASSES];
+
+                PeerQueue(std::pmr::memory_resource* resource)
+                    : m_tokens(0.0), m_classes{ ClassQueue(resource), ClassQueue(resource), ClassQueue(resource) }
+                { }
+        };
+
+        class ClassStats {
+            public:
+                uint64_t    m_queued;
+                uint64_t    m_sent;
+                uint64_t    m_dropped;  // expired or queue overflow
+                uint64_t    m_merged;   // replaced by a newer update before being sent
+                uint64_t    m_depth;    // currently queued
+
+                ClassStats() : m_queued(0), m_sent(0), m_dropped(0), m_merged(0), m_depth(0) {}
+        };
+
+        UDP&                                    m_udp;
+        SendSchedulerParams                     m_params;
+        std::pmr::memory_resource*              m_resource;
+        std::vector<PeerQueue>                  m_peers;
+        std::unordered_map<uint64_t, size_t>    m_peerIndex;    // UDPAddress key -> index in m_peers
+        size_t                                  m_nextPeer;     // round robin start
+        tClock::time_point                      m_tickStart;
+        uint64_t                                m_tickBacklog;  // paced messages queued when the tick started
+        uint64_t                                m_tickSent;     // paced messages sent since
+        ClassStats                              m_stats[SEND_PRIORITY_CLASSES];
+
+        // resource: where queued messages live; nullptr: the default resource
+        SendScheduler(UDP& udp, const SendSchedulerParams& params = SendSchedulerParams(), std::pmr::memory_resource* resource = nullptr)
+            : m_udp(udp), m_params(params), m_resource(resource ? resource : std::pmr::get_default_resource()), m_nextPeer(0), m_tickBacklog(0), m_tickSent(0)
+        { }
+
+        bool Queue(const UDPPeer& peer, const String& message, SendPriority priority, bool merge = false);
+
+        // send whatever budget and pacing allow; returns the number of messages sent
+        int Update(void);
+
+        // send everything queued regardless of pacing (bandwidth budgets still apply)
+        int Flush(void);
+
+        inline const ClassStats& Stats(SendPriority priority) const {
+            return m_stats[int(priority)];
+        }
+
+    private:
+        int Send(bool paced);
+
+        void Refill(PeerQueue& peer, tClock::time_point now);
+
+        void DropExpired(PeerQueue& peer, tClock::time_point now);
+};
+
+// =================================================================================================
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+
+#include "memorymap.h"
+#include "udpdatagram.h"
+
+// =================================================================================================
+// Datagram transport between processes on the same host. Every endpoint owns an inbox: a ring of
+// datagram slots in shared memory, named after the endpoint's receive port. Senders map the inbox of
+// a local destination once and write datagrams straight into it (same lock-free algorithm as
+// LockFreeQueue, with the cells in shared memory), so no system call or kernel copy is involved.
+// Send() returns false for remote destinations, destinations without inbox and full inboxes;
+// UDP then falls back to the socket.
+
+#define SHARED_MEMORY_MAGIC 0x534D5231 // "SMR1"
+
+class SharedMemoryTransport {
+    public:
+        typedef std::chrono::steady_clock tClock;
+
+        struct RingHeader {
+            std::atomic<uint32_t>                       m_magic;    // set last when the inbox is ready
+            std::atomic<uint32_t>                       m_closed;   // set when the owner closes the inbox
+            uint32_t                                    m_capacity; // power of two
+            int32_t                                     m_owner;    // process id of the receiver
+            alignas(64) std::atomic<uint64_t>           m_pushPos;
+            alignas(64) std::atomic<uint64_t>           m_popPos;
+        };
+
+        struct Cell {
+            std::atomic<uint64_t>   m_sequence;
+            UDPDatagram             m_datagram;
+        };
+
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory rings need address free atomics");
+
+        class Ring {
+            public:
+                MemoryMap   m_map;
+                RingHeader* m_header;
+                Cell*       m_cells;
+                uint64_t    m_mask;
+
+                Ring() : m_header(nullptr), m_cells(nullptr), m_mask(0) {}
+
+                ~Ring() {
+                    Close();
+                }
+
+                bool Create(const char* name, uint32_t capacity);
+
+                bool Open(const char* name);
+
+                void Close(void);
+
+                inline bool IsOpen(void) const {
+                    return m_header != nullptr;
+                }
+
+                bool Push(const UDPAddress& source, const char* prefix, size_t prefixLength, const char* data, size_t length);
+
+                bool Pop(UDPDatagram& datagram);
+        };
+
+        class Outbox {
+            public:
+                Ring                m_ring;
+                tClock::time_point  m_lastCheck;    // last attempt to open the ring or check its owner
+        };
+
+        Ring                                                    m_inbox;
+        UDPAddress                                              m_source;   // our host and send port, reported as sender
+        std::unordered_map<uint16_t, std::unique_ptr<Outbox>>   m_outboxes; // destination port (network order) -> ring
+        // statistics
+        uint64_t                                                m_sent;
+        uint64_t                                                m_received;
+        uint64_t                                                m_fallbacks; // local destinations served by the socket
+
+        SharedMemoryTransport() : m_sent(0), m_received(0), m_fallbacks(0) {}
+
+        // create the inbox for receivePort; source is what receivers see as sender address
+        bool Open(uint16_t receivePort, const UDPAddress& source, uint32_t capacity = 1024);
+
+        void Close(void);
+
+        inline bool IsOpen(void) const {
+            return m_inbox.IsOpen();
+        }
+
+        bool IsLocal(const UDPAddress& target) const;
+
+        bool Send(const UDPAddress& target, const char* prefix, size_t prefixLength, const char* data, size_t length);
+
+        inline bool Receive(UDPDatagram& datagram) {
+            if (not (m_inbox.IsOpen() and m_inbox.Pop(datagram)))
+                return false;
+            ++m_received;
+            return true;
+        }
+
+        // move pending datagrams into the free slots of ring
+        int ReceiveBatch(UDPDatagramRing& ring);
+
+    private:
+        Ring* Outbound(const UDPAddress& target);
+
+        static void InboxName(uint16_t port, char* name, size_t size);
+};
+
+// =================================================================================================
@@ -1,22 +1,44 @@
 #pragma once
 
 #include <tuple>
+#include <memory_resource>
 #include "tabledimensions.h"
+#include "table.h"
 #include "list.hpp"
 #include "string.hpp"
 #include <functional> // Add this include for std::function
 
 // =================================================================================================
 
+// The resource arguments are for the loaders' temporary buffers (e.g. an ArenaResource for a one-shot
+// load); nullptr means the default resource. The lines themselves are Strings on the heap.
+
 class TextFileLoader {
     public:
         typedef std::function<bool(String&)> tLineFilter; // Use std::function instead of raw function pointer
 
-        TableDimensions ReadLines (const char * fileName, List<String>& fileLines, tLineFilter filter);
+        TableDimensions ReadLines (const char * fileName, List<String>& fileLines, tLineFilter filter, std::pmr::memory_resource* resource = nullptr);
+
+        TableDimensions CopyLines(const String& lineBuffer, List<String>& textLines, tLineFilter filter, std::pmr::memory_resource* resource = nullptr);
+
+        TableDimensions ReadStream(std::istream& stream, List<String>& textLines, tLineFilter filter, std::pmr::memory_resource* resource = nullptr);
+
+        // split file contents already in memory into lines (LF or CR LF line ends)
+        TableDimensions ParseLines(const char* data, size_t length, List<String>& textLines, tLineFilter filter);
 
-        TableDimensions CopyLines(const String& lineBuffer, List<String>& textLines, tLineFilter filter);
+        // same result as ReadLines, but the file is read in one go and split and filtered in chunks of
+        // about chunkSize bytes on the job system. filter must be safe to call from several threads.
+        // Only the calling thread allocates from resource (the file contents and the chunk table).
+        TableDimensions ReadLinesParallel(const char* fileName, List<String>& textLines, tLineFilter filter, size_t chunkSize = 1 << 20,
+                                          std::pmr::memory_resource* resource = nullptr);
 
-        TableDimensions ReadStream(std::istream& stream, List<String>& textLines, tLineFilter filter);
+        // Load a grid straight into table, without Strings in between; every line is a row.
+        // Table<char>: every character is a cell (maps); short rows are padded with blanks.
+        // Numbers (uint8_t, int16_t, uint16_t, int, uint32_t, float, double): values are separated by
+        // blanks, tabs, ',' or ';'; empty lines and lines starting with '#' are skipped; missing and
+        // unreadable values are 0. table's tile size is kept.
+        template <typename T>
+        TableDimensions ReadTable(const char* fileName, Table<T>& table, TableLayout layout = TableLayout::RowMajor, std::pmr::memory_resource* resource = nullptr);
 };
 
 // =================================================================================================
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+#include "string.hpp"
+#include "networkmessage.h"
+#include "udp.h"
+
+// =================================================================================================
+// Clock synchronization between peers (NTP style). Peers added with AddPeer() are probed
+// periodically; every probe/reply round gives the four time stamps
+//   t1: probe sent (local clock)   t2: probe received (peer clock)
+//   t3: reply sent (peer clock)    t4: reply received (local clock)
+// and with them a sample of the peer's clock offset ((t2 - t1) + (t3 - t4)) / 2 and of the round
+// trip delay (t4 - t1) - (t3 - t2). Queuing delays only ever add to the delay, so the samples with
+// the smallest delay have the most accurate offsets: each peer keeps the last filterSize samples and
+// fits offset and drift to the better half of them by delay (least squares; the offset of the
+// minimum delay sample alone while they span less than minDriftSpan). The round trip time is
+// smoothed like ReliableChannel's (RFC 6298). Asymmetric paths can't be detected: half the
+// difference between the two one-way delays ends up in the offset.
+// Every instance answers probes, whether it probes the sender or not. Time stamps are µs of the
+// local steady clock (NetworkStats::Now()), so offsets are only meaningful between TimeSync
+// instances, not as wall clock time.
+//
+// Wire format (numbers in hex except the port):
+//   probe: @tsync#<port>:<t1>
+//   reply: @tsack#<port>:<t1>:<t2>:<t3>
+// <port> is the sender's receive port (datagrams come from its send socket), as with ReliableChannel.
+// Malformed sync messages are dropped, and so are replies whose t1 isn't one of the last 8 probes
+// sent to that peer (forged, duplicated or very late replies).
+
+struct TimeSyncParams {
+    int         interval = 1000;        // ms between probes once synchronized
+    int         burstInterval = 50;     // ms between the first probes
+    int         burstCount = 8;         // probes sent at burstInterval after AddPeer
+    int         filterSize = 16;        // samples kept per peer (at most 64)
+    int         minSamples = 4;         // samples needed before a peer counts as synchronized
+    int         minDriftSpan = 4000;    // ms the good samples must span before drift is estimated
+    int         delayMargin = 200;      // µs above the minimum delay a sample always counts as good
+    // testing: distort this instance's clock and delay its sync messages (simulated latency without a network)
+    int64_t     simulatedOffset = 0;    // µs added to the local clock
+    float       simulatedDrift = 0.0f;  // ppm the local clock runs fast
+    int         simulatedDelay = 0;     // µs outgoing probes and replies are held back
+    int         simulatedJitter = 0;    // µs of random extra delay (0 .. simulatedJitter)
+};
+
+
+class TimeSync {
+    public:
+        class Sample {
+            public:
+                int64_t     m_time;     // local clock at t4
+                int64_t     m_offset;   // µs, peer clock - local clock
+                int64_t     m_delay;    // µs, round trip without the peer's processing time
+        };
+
+        class PeerClock {
+            public:
+                UDPPeer     m_peer;
+                bool        m_isProbed;         // added with AddPeer
+                uint64_t    m_nextProbe;        // NetworkStats::Now() when the next probe is due
+                int         m_burstLeft;
+                uint64_t    m_pending[8];       // t1 of the last probes sent; a reply has to echo one of them (0: free)
+                int         m_nextPending;
+                Sample      m_samples[64];      // ring of the last filterSize samples
+                int         m_sampleCount;
+                int         m_nextSample;
+                // estimate: offset(t) = m_offset + m_drift * (t - m_reference)
+                int64_t     m_reference;        // local clock
+                double      m_offset;           // µs
+                double      m_drift;            // µs per µs
+                int64_t     m_minDelay;         // µs, smallest delay in the filter
+                // round trip time (RFC 6298)
+                float       m_srtt;             // µs
+                float       m_rttVar;           // µs
+                // statistics
+                uint64_t    m_probes;
+                uint64_t    m_replies;
+                uint64_t    m_rejected;         // replies with impossible time stamps or to no pending probe
+
+                PeerClock()
+                    : m_isProbed(false), m_nextProbe(0), m_burstLeft(0), m_pending{}, m_nextPending(0), m_samples{}, m_sampleCount(0), m_nextSample(0),
+                      m_reference(0), m_offset(0.0), m_drift(0.0), m_minDelay(0), m_srtt(0.0f), m_rttVar(0.0f),
+                      m_probes(0), m_replies(0), m_rejected(0)
+                { }
+        };
+
+        // sync message held back by simulatedDelay
+        class Held {
+            public:
+                uint64_t    m_due;      // NetworkStats::Now()
+                UDPPeer     m_peer;
+                std::string m_data;
+        };
+
+        UDP&                                    m_udp;
+        TimeSyncParams                          m_params;
+        std::unordered_map<uint64_t, PeerClock> m_peers;    // UDPAddress key (host + receive port) -> clock
+        std::deque<Held>                        m_held;
+        uint64_t                                m_epoch;    // NetworkStats::Now() at construction (simulated drift)
+        uint32_t                                m_jitterState;
+        // statistics
+        uint64_t                                m_answered; // probes answered
+        uint64_t                                m_bytesSent;
+
+        TimeSync(UDP& udp, const TimeSyncParams& params = TimeSyncParams());
+
+        // start probing peer (a burst first, then every interval ms)
+        void AddPeer(const UDPPeer& peer);
+
+        bool RemovePeer(const UDPPeer& peer);
+
+        // handle a probe or reply; returns false for all other messages
+        bool Decode(Message& message);
+
+        // send the probes that are due (and held messages; call once per tick). Returns the number sent.
+        int Update(void);
+
+        // local clock in µs
+        inline int64_t Clock(void) const {
+            return Clock(NetworkStats::Now());
+        }
+
+        int64_t Clock(uint64_t now) const;
+
+        // true once peer has answered minSamples probes
+        bool IsSynchronized(const UDPPeer& peer) const;
+
+        // µs the peer's clock is ahead of the local one at local time (0: now); 0 if unknown
+        double Offset(const UDPPeer& peer, int64_t time = 0) const;
+
+        // local time to peer time and back
+        inline int64_t ToPeer(const UDPPeer& peer, int64_t time) const {
+            return time + int64_t(Offset(peer, time));
+        }
+
+        inline int64_t ToLocal(const UDPPeer& peer, int64_t time) const {
+            return time - int64_t(Offset(peer, time));
+        }
+
+        // ppm the peer's clock runs faster than the local one
+        double Drift(const UDPPeer& peer) const;
+
+        // smoothed round trip time and one-way latency (half of it) in µs, 0 if not measured yet
+        float RoundTripTime(const UDPPeer& peer) const;
+
+        inline float Latency(const UDPPeer& peer) const {
+            return RoundTripTime(peer) / 2.0f;
+        }
+
+        std::string ToText(void) const;
+
+    private:
+        const PeerClock* Find(const UDPPeer& peer) const;
+
+        void Send(const UDPPeer& peer, const char* data, size_t length);
+
+        void Probe(PeerClock& peer, uint64_t now);
+
+        void Answer(const UDPPeer& peer, uint64_t t1, int64_t t2);
+
+        void AddSample(PeerClock& peer, int64_t t1, int64_t t2, int64_t t3, int64_t t4);
+
+        void Estimate(PeerClock& peer);
+};
+
+// =================================================================================================
@@ -1,33 +1,133 @@
 #pragma once 
 
 #include <stdint.h>
+#include <vector>
+
+// USE_POSIX_SOCKETS selects the socket backend: 0 = SDL_net (default), 1 = native POSIX sockets.
+// Both backends implement the same UDPSocket interface. Only the POSIX backend supports
+// socket buffer tuning, blocking receive with timeout and SO_REUSEPORT (see UDPReceiverGroup).
+#ifndef USE_POSIX_SOCKETS
+#   define USE_POSIX_SOCKETS 0
+#endif
+
+#if USE_POSIX_SOCKETS
+#   include <sys/types.h>
+#   include <sys/socket.h>
+#   include <sys/uio.h>
+#   include <netinet/in.h>
+#else
+#   include "SDL_net.h"
+#endif
 
-#include "SDL_net.h"
 #include "string.hpp"
 #include "networkmessage.h"
+#include "udpdatagram.h"
+#include "sharedmemorytransport.h"
+#include "networkcapture.h"
+#include "networkstats.h"
+#include "payloadcompressor.h"
 
 // =================================================================================================
 // UDP based networking
 
+// Destination handle: the host name is resolved once when the peer is set up instead of on every send.
+// Sending to a peer uses the unbound send channel, so no socket channel has to be bound per send either.
+
+class UDPPeer {
+    public:
+        String      m_address;
+        uint16_t    m_port;
+        UDPAddress  m_target;
+        bool        m_isValid;
+
+        UDPPeer() : m_port(0), m_isValid(false) {}
+
+        UDPPeer(String address, uint16_t port) {
+            Resolve(address, port);
+        }
+
+        bool Resolve(String address, uint16_t port);
+
+        inline bool IsValid(void) const {
+            return m_isValid;
+        }
+};
+
+// =================================================================================================
+// Socket options. The SDL_net backend ignores everything except the defaults.
+
+struct UDPSocketParams {
+    int     receiveBufferSize = 0;  // SO_RCVBUF in bytes, 0: system default
+    int     sendBufferSize = 0;     // SO_SNDBUF in bytes, 0: system default
+    int     receiveTimeout = 0;     // ms a blocking receive waits before returning 0; 0: wait forever
+    bool    nonBlocking = true;     // false: ReceiveBatch waits for the first datagram
+    bool    reusePort = false;      // SO_REUSEPORT: several sockets share the port, the kernel spreads flows among them
+    float   simulatedLoss = 0.0f;   // share of received datagrams thrown away on purpose (testing loss handling); all backends
+};
+
+// =================================================================================================
+
 class UDPSocket {
     public:
         String      m_localAddress;
         uint16_t    m_localPort;
+#if USE_POSIX_SOCKETS
+        int         m_socket;
+#else
         UDPsocket   m_socket;
         UDPpacket*  m_packet;
         IPaddress   m_address;
         int         m_channel;
+#endif
         bool        m_isValid;
+        UDPSocketParams m_params;
+        UDPDatagram m_buffer;   // scratch datagram for single sends and receives
+        uint32_t    m_lossState;    // random state for simulated loss
+        uint64_t    m_simulatedDrops;
+        uint64_t    m_truncatedDrops;   // received datagrams dropped because they were larger than a slot
+        TrafficCounters m_traffic;
 
     private:
+#if USE_POSIX_SOCKETS
+        // message headers pointing into the slots of the datagram ring currently being filled or sent
+        std::vector<struct iovec>       m_iovecs;
+        std::vector<struct sockaddr_in> m_peers;
+        std::vector<uint8_t>            m_truncated;    // per slot: MSG_TRUNC was reported
+#   ifdef __linux__
+        std::vector<struct mmsghdr>     m_messages;
+#   endif
+
+        void PrepareVector(UDPDatagram* slots, uint32_t count, bool sending);
+#else
+        // packet headers pointing into the slots of the datagram ring currently being filled
+        std::vector<UDPpacket>  m_packetHeaders;
+        std::vector<UDPpacket*> m_packetVector;
+
+        UDPpacket** PacketVector(UDPDatagram* slots, uint32_t count);
+
         int Bind (String& address, uint16_t port);
 
         inline void Unbind(void) {
             SDLNet_UDP_Unbind(m_socket, m_channel);
         }
+#endif
+
+        int ReceiveBatch(UDPDatagram* slots, uint32_t count, bool wait);
+
+        // remove the datagrams hit by simulated loss from slots; returns the number left
+        int SimulateLoss(UDPDatagram* slots, int count);
+
+        void CountSent(const UDPSendQueue& queue, int sent);
 
     public:
-        UDPSocket() : m_localAddress(String("127.0.0.1")), m_localPort(0), m_packet(nullptr), m_channel(0), m_isValid(false) {
+#if USE_POSIX_SOCKETS
+        UDPSocket() : m_localAddress(String("127.0.0.1")), m_localPort(0), m_socket(-1), m_isValid(false), m_lossState(0x9E3779B9), m_simulatedDrops(0), m_truncatedDrops(0) {}
+
+        ~UDPSocket() {
+            Close();
+        }
+#else
+        UDPSocket() : m_localAddress(String("127.0.0.1")), m_localPort(0), m_packet(nullptr), m_channel(0), m_isValid(false), m_lossState(0x9E3779B9), m_simulatedDrops(0), m_truncatedDrops(0) {
             memset(&m_address, 0, sizeof(m_address));
             memset(&m_socket, 0, sizeof(m_socket));
         }
@@ -38,33 +138,81 @@ class UDPSocket {
                 m_packet = nullptr;
             }
         }
+#endif
 
-        bool Open(String localAddress, uint16_t localPort);
+        UDPSocket(const UDPSocket&) = delete;
+
+        UDPSocket& operator=(const UDPSocket&) = delete;
+
+        inline bool Open(String localAddress, uint16_t localPort) {
+            return Open(localAddress, localPort, UDPSocketParams());
+        }
+
+        bool Open(String localAddress, uint16_t localPort, const UDPSocketParams& params);
 
         void Close(void);
 
         bool Send(String message, String address, uint16_t port);
 
+        // gather prefix and message into one datagram and send it to peer
+        bool Send(const UDPPeer& peer, const char* prefix, size_t prefixLength, const char* message, size_t length);
+
+        // send all datagrams in queue with one call and empty it. Returns the number of datagrams sent or -1 on error.
+        int SendBatch(UDPSendQueue& queue);
+
 
         String Receive(String& address, uint16_t& port);
 
+        // receive a single datagram into a slot. Returns false if nothing is pending.
+        bool Receive(UDPDatagram& datagram);
+
+        // drain all pending datagrams into the free slots of ring. Returns the number of datagrams received or -1 on error.
+        int ReceiveBatch(UDPDatagramRing& ring);
+
 };
 
 // =================================================================================================
 
+// A datagram starts with the message prefix, followed by one or more messages separated by
+// UDP_MESSAGE_SEPARATOR (see MessageCoalescer). A datagram with a single message is the same as before.
+// Receivers split every datagram at the separator, whoever sent it, so messages can't contain '\n'
+// (before coalescing it was an ordinary payload byte; now such a message arrives as two).
+// MessageCoalescer::Queue rejects these messages; UDP::Transmit and UDP::Queue send them unchanged.
+#define UDP_MESSAGE_PREFIX          "SMIBAT"
+#define UDP_MESSAGE_PREFIX_LENGTH   6
+#define UDP_MESSAGE_SEPARATOR       '\n'
+// Datagrams whose payload (everything after the prefix) is compressed by PayloadCompressor start
+// with this prefix instead. UDP's receive functions decompress them, so they look like any other datagram.
+#define UDP_COMPRESSED_PREFIX       "SMIBAZ"
+
 class UDP {
     public:
 
-        String     m_localAddress;
-        UDPSocket  m_sockets[2];
+        String      m_localAddress;
+        UDPSocket   m_sockets[2];
+        UDPDatagram m_datagram;
+        uint16_t    m_datagramOffset;   // read position of Receive() in m_datagram
+        UDPSendQueue m_sendQueue;
+        SharedMemoryTransport m_sharedMemory;  // used for peers on the same host once enabled
+        CaptureRecorder*    m_recorder;     // logs all traffic if set
+        CaptureReplay*      m_replay;       // replaces the receive socket if set
+        NetworkStats        m_stats;
+        PayloadCompressor   m_compressor;   // compresses datagrams sent through the sockets once enabled
 
-        UDP() : m_localAddress(String("127.0.0.1")) {}
+        UDP() : m_localAddress(String("127.0.0.1")), m_datagramOffset(0), m_recorder(nullptr), m_replay(nullptr) {
+            m_stats.m_sockets[0] = &m_sockets[0].m_traffic;
+            m_stats.m_sockets[1] = &m_sockets[1].m_traffic;
+        }
 
 
         bool OpenSocket(uint16_t port, int type) {     // 0: read, 1: write
             return m_sockets[type].Open(m_localAddress, port);
         }
 
+        bool OpenSocket(uint16_t port, int type, const UDPSocketParams& params) {
+            return m_sockets[type].Open(m_localAddress, port, params);
+        }
+
 
         inline uint16_t InPort(void) {
             return m_sockets[0].m_localPort;
@@ -74,13 +222,64 @@ class UDP {
             return m_sockets[1].m_localPort;
         }
 
+        // deliver messages to and from processes on this host through shared memory instead of the
+        // network stack. Call after opening both sockets; remote peers keep using the sockets.
+        bool EnableSharedMemory(uint32_t capacity = 1024);
+
         bool Transmit(String message, String address, uint16_t port) {
-            return m_sockets[1].Send(String("SMIBAT") + message, address, port);
+            UDPPeer peer(address, port);
+            return peer.IsValid() and Transmit(peer, message);
+        }
+
+        inline bool Transmit(const UDPPeer& peer, const String& message) {
+            return Transmit(peer, message.Data(), message.Length());
+        }
+
+        bool Transmit(const UDPPeer& peer, const char* message, size_t length);
+
+        // queue message for peer; the queue is sent with Flush() (usually once per tick) or when it runs full
+        inline bool Queue(const UDPPeer& peer, const String& message) {
+            return peer.IsValid() and Queue(peer.m_target, message.Data(), message.Length());
+        }
+
+        bool Queue(const UDPAddress& target, const char* message, size_t length);
+
+        inline int Flush(void) {
+            return m_sockets[1].SendBatch(m_sendQueue);
         }
 
 
         Message Receive(void);
 
+        // drain the receive socket into ring; use NextMessage() to turn the slots into messages
+        int ReceiveBatch(UDPDatagramRing& ring);
+
+        // extract the message at offset from a received datagram and advance offset to the next one.
+        // Start with offset = 0; returns false when the datagram holds no more messages.
+        static bool NextMessage(const UDPDatagram& datagram, uint16_t& offset, Message& message);
+
+        // log every datagram sent and received to recorder (nullptr: stop recording)
+        inline void Record(CaptureRecorder* recorder) {
+            m_recorder = recorder;
+        }
+
+        // take received datagrams from replay instead of the receive socket (nullptr: back to the socket)
+        inline void Replay(CaptureReplay* replay) {
+            m_replay = replay;
+        }
+
+    private:
+        // compress message into buffer if enabled and worth it; prefix and message then point to the
+        // compressed version. Returns the length of what message points to.
+        size_t Compress(const char*& prefix, const char*& message, size_t length, uint8_t* buffer);
+
+        // decompress datagram in place if it is compressed; a corrupt one is emptied
+        void Expand(UDPDatagram& datagram);
+
+        bool ReceiveDatagram(UDPDatagram& datagram);
+
+        void CountReceived(const UDPDatagram& datagram);
+
 };
 
 // =================================================================================================
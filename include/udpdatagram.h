@@ -0,0 +1,248 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// =================================================================================================
+// Binary datagram storage for batched UDP traffic.
+// Addresses are kept the way the socket layer delivers them (IPv4 host and port in network byte
+// order, same layout as SDL_net's IPaddress). They are only formatted as text when somebody asks for it.
+
+#define UDP_MAX_DATAGRAM_SIZE 1500
+
+class UDPAddress {
+    public:
+        uint32_t    m_host; // network byte order
+        uint16_t    m_port; // network byte order
+
+        UDPAddress(uint32_t host = 0, uint16_t port = 0) : m_host(host), m_port(port) {}
+
+        inline bool operator== (const UDPAddress& other) const {
+            return (m_host == other.m_host) and (m_port == other.m_port);
+        }
+
+        inline bool operator!= (const UDPAddress& other) const {
+            return not (*this == other);
+        }
+
+        inline bool IsValid(void) const {
+            return m_host != 0;
+        }
+
+        // port in host byte order
+        inline uint16_t Port(void) const {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(&m_port);
+            return uint16_t((p[0] << 8) | p[1]);
+        }
+
+        inline void SetPort(uint16_t port) {
+            uint8_t* p = reinterpret_cast<uint8_t*>(&m_port);
+            p[0] = uint8_t(port >> 8);
+            p[1] = uint8_t(port);
+        }
+
+        // 64 bit key for hashing and lookup tables
+        inline uint64_t Key(void) const {
+            return (uint64_t(m_host) << 16) | uint64_t(m_port);
+        }
+
+        // write the host as dotted quad into buffer (needs room for 16 chars); returns the text length
+        int FormatHost(char* buffer) const {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(&m_host);
+            char* s = buffer;
+            for (int i = 0; i < 4; i++) {
+                uint8_t b = p[i];
+                if (b >= 100)
+                    *s++ = char('0' + b / 100);
+                if (b >= 10)
+                    *s++ = char('0' + (b / 10) % 10);
+                *s++ = char('0' + b % 10);
+                if (i < 3)
+                    *s++ = '.';
+            }
+            *s = '\0';
+            return int(s - buffer);
+        }
+
+        // inverse of FormatHost; returns false if host isn't a dotted quad
+        bool ParseHost(const char* host) {
+            uint8_t* p = reinterpret_cast<uint8_t*>(&m_host);
+            for (int i = 0; i < 4; i++) {
+                int b = 0, digits = 0;
+                for (; (*host >= '0') and (*host <= '9') and (digits < 3); host++, digits++)
+                    b = b * 10 + (*host - '0');
+                if ((digits == 0) or (b > 255) or ((i < 3) and (*host++ != '.')))
+                    return false;
+                p[i] = uint8_t(b);
+            }
+            return true;
+        }
+};
+
+// =================================================================================================
+// One fixed size datagram slot
+
+class UDPDatagram {
+    public:
+        UDPAddress  m_address;
+        uint16_t    m_length;
+        uint8_t     m_data[UDP_MAX_DATAGRAM_SIZE];
+
+        UDPDatagram() : m_length(0) {}
+
+        inline const char* Data(void) const {
+            return reinterpret_cast<const char*>(m_data);
+        }
+
+        inline bool HasPrefix(const char* prefix, size_t prefixLength) const {
+            return (m_length >= prefixLength) and (memcmp(m_data, prefix, prefixLength) == 0);
+        }
+
+        // gather prefix and payload into the slot. Fails if the result doesn't fit into a datagram.
+        inline bool Assign(const UDPAddress& address, const char* prefix, size_t prefixLength, const char* data, size_t length) {
+            if (prefixLength + length > UDP_MAX_DATAGRAM_SIZE)
+                return false;
+            m_address = address;
+            if (prefixLength)
+                memcpy(m_data, prefix, prefixLength);
+            if (length)
+                memcpy(m_data + prefixLength, data, length);
+            m_length = uint16_t(prefixLength + length);
+            return true;
+        }
+};
+
+// =================================================================================================
+// Preallocated ring of datagram slots. The socket layer fills the free slots in as few calls as
+// possible (see UDPSocket::ReceiveBatch), the application consumes them with Front() and Pop().
+// Slots are reused, so draining the socket doesn't allocate anything.
+
+class UDPDatagramRing {
+    public:
+        UDPDatagram*    m_slots;
+        uint32_t        m_capacity;
+        uint32_t        m_head;
+        uint32_t        m_count;
+        // statistics
+        uint64_t        m_received;     // datagrams written to the ring
+        uint64_t        m_drains;       // calls to UDPSocket::ReceiveBatch
+        uint64_t        m_overflows;    // drains that stopped because the ring was full (data may still be pending)
+
+        UDPDatagramRing(uint32_t capacity = 256)
+            : m_capacity(capacity), m_head(0), m_count(0), m_received(0), m_drains(0), m_overflows(0)
+        {
+            m_slots = new UDPDatagram[capacity];
+        }
+
+        ~UDPDatagramRing() {
+            delete[] m_slots;
+            m_slots = nullptr;
+        }
+
+        UDPDatagramRing(const UDPDatagramRing&) = delete;
+
+        UDPDatagramRing& operator=(const UDPDatagramRing&) = delete;
+
+        inline uint32_t Capacity(void) const {
+            return m_capacity;
+        }
+
+        inline uint32_t Length(void) const {
+            return m_count;
+        }
+
+        inline bool IsEmpty(void) const {
+            return m_count == 0;
+        }
+
+        inline bool IsFull(void) const {
+            return m_count == m_capacity;
+        }
+
+        inline UDPDatagram& Front(void) {
+            return m_slots[m_head];
+        }
+
+        inline void Pop(void) {
+            if (m_count > 0) {
+                if (++m_head == m_capacity)
+                    m_head = 0;
+                --m_count;
+            }
+        }
+
+        inline void Clear(void) {
+            m_head = m_count = 0;
+        }
+
+        // contiguous free slots starting at the write position. Wrapping is handled by calling this again after Commit().
+        inline UDPDatagram* FreeSpan(uint32_t& length) {
+            uint32_t tail = m_head + m_count;
+            if (tail >= m_capacity)
+                tail -= m_capacity;
+            length = (tail >= m_head) ? m_capacity - tail : m_head - tail;
+            if (IsFull())
+                length = 0;
+            return m_slots + tail;
+        }
+
+        // mark n slots returned by FreeSpan as filled
+        inline void Commit(uint32_t n) {
+            m_count += n;
+            m_received += n;
+        }
+};
+
+// =================================================================================================
+// Outgoing datagrams collected during a tick and sent with one call to UDPSocket::SendBatch.
+
+class UDPSendQueue {
+    public:
+        UDPDatagram*    m_slots;
+        uint32_t        m_capacity;
+        uint32_t        m_count;
+        // statistics
+        uint64_t        m_queued;
+        uint64_t        m_flushes;
+
+        UDPSendQueue(uint32_t capacity = 64)
+            : m_capacity(capacity), m_count(0), m_queued(0), m_flushes(0)
+        {
+            m_slots = new UDPDatagram[capacity];
+        }
+
+        ~UDPSendQueue() {
+            delete[] m_slots;
+            m_slots = nullptr;
+        }
+
+        UDPSendQueue(const UDPSendQueue&) = delete;
+
+        UDPSendQueue& operator=(const UDPSendQueue&) = delete;
+
+        inline uint32_t Length(void) const {
+            return m_count;
+        }
+
+        inline bool IsEmpty(void) const {
+            return m_count == 0;
+        }
+
+        inline bool IsFull(void) const {
+            return m_count == m_capacity;
+        }
+
+        inline void Clear(void) {
+            m_count = 0;
+        }
+
+        inline bool Queue(const UDPAddress& address, const char* prefix, size_t prefixLength, const char* data, size_t length) {
+            if (IsFull() or not m_slots[m_count].Assign(address, prefix, prefixLength, data, length))
+                return false;
+            ++m_count;
+            ++m_queued;
+            return true;
+        }
+};
+
+// =================================================================================================
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "string.hpp"
+#include "udp.h"
+
+// =================================================================================================
+// Multi-core receive: N receiver threads, each owning its own socket on the same port (SO_REUSEPORT).
+// The kernel distributes incoming flows among the sockets, so every thread drains its own share
+// into its own datagram ring and hands it to the handler. The handler runs on the receiver thread
+// and has to consume (Pop) what it wants to keep; anything left in the ring is discarded afterwards.
+// Port sharing requires the POSIX socket backend; with SDL_net only one receiver is started.
+
+class UDPReceiverGroup {
+    public:
+        typedef std::function<void(int worker, UDPDatagramRing& ring)> tHandler;
+
+        class Receiver {
+            public:
+                UDPSocket               m_socket;
+                UDPDatagramRing         m_ring;
+                std::thread             m_thread;
+                std::atomic<uint64_t>   m_received;
+                std::atomic<uint64_t>   m_batches;
+
+                Receiver(uint32_t ringCapacity) : m_ring(ringCapacity), m_received(0), m_batches(0) {}
+        };
+
+        std::vector<std::unique_ptr<Receiver>>  m_receivers;
+        std::atomic<bool>                       m_isRunning;
+
+        UDPReceiverGroup() : m_isRunning(false) {}
+
+        ~UDPReceiverGroup() {
+            Stop();
+        }
+
+        // params.reusePort is forced on for more than one receiver. Receivers use blocking sockets with
+        // a receive timeout (params.receiveTimeout, 100 ms if unset) so they sleep while idle and still notice Stop().
+        bool Start(String localAddress, uint16_t port, int receiverCount, tHandler handler, UDPSocketParams params = UDPSocketParams(), uint32_t ringCapacity = 256);
+
+        void Stop(void);
+
+        inline int ReceiverCount(void) const {
+            return int(m_receivers.size());
+        }
+
+        uint64_t Received(void) const;
+
+    private:
+        void Run(int worker, tHandler handler);
+};
+
+// =================================================================================================
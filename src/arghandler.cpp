@@ -6,6 +6,7 @@
 
 #include "arghandler.h"
 #include "dictionary.hpp"
+#include "tracing.h"
 
 // =================================================================================================
 
@@ -146,6 +147,7 @@ bool ArgHandler::LineFilter (String& line) {
 
 
 int ArgHandler::LoadArgs(int argC, char** argV) {
+    TRACE_ZONE("ArgHandler::LoadArgs");
 #if !(USE_STD || USE_STD_MAP)
     m_argList.SetComparator(String::Compare);
 #endif
@@ -155,12 +157,13 @@ int ArgHandler::LoadArgs(int argC, char** argV) {
 }
 
 
-int ArgHandler::LoadArgs(const char* fileName) {
+int ArgHandler::LoadArgs(const char* fileName, std::pmr::memory_resource* resource) {
+    TRACE_ZONE("ArgHandler::LoadArgs");
     TextFileLoader  f;
     List<String>    fileLines;
 
     auto lineFilterWrapper = [this](String& line) { return this->LineFilter(line); };
-    TableDimensions argC = f.ReadLines (fileName, fileLines, lineFilterWrapper);
+    TableDimensions argC = f.ReadLines (fileName, fileLines, lineFilterWrapper, resource);
     if (argC.GetRows() > 0)
         for (auto& line : fileLines)
             Add(line);
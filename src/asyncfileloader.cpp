@@ -0,0 +1,198 @@
+#include <errno.h>
+#include <stdio.h>
+#include <algorithm>
+
+#ifndef _WIN32
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/stat.h>
+#endif
+
+#include "asyncfileloader.h"
+#include "tracing.h"
+
+// =================================================================================================
+
+AsyncFileLoader::AsyncFileLoader(int threadCount)
+    : m_isRunning(true), m_nextSequence(0), m_loaded(0), m_failed(0), m_bytes(0)
+{
+    for (int i = std::max(threadCount, 1); i > 0; i--)
+        m_threads.emplace_back(&AsyncFileLoader::Run, this);
+}
+
+
+AsyncFileLoader::~AsyncFileLoader() {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_isRunning = false;
+        m_requests = std::priority_queue<Request>();
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads)
+        if (thread.joinable())
+            thread.join();
+}
+
+
+void AsyncFileLoader::Hint(const std::string& fileName) {
+#if !defined(_WIN32) && !defined(__APPLE__)
+    int fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);   // starts the read-ahead
+        close(fd);
+    }
+#endif
+}
+
+
+void AsyncFileLoader::Prefetch(const char* fileName) {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_hints.size() >= maxHints)
+            return;
+        m_hints.emplace_back(fileName);
+    }
+    m_wake.notify_one();
+}
+
+
+void AsyncFileLoader::Queue(const char* fileName, LoadPriority priority, tFileCallback complete) {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if ((priority != LoadPriority::Now) and (m_hints.size() < maxHints))
+            m_hints.emplace_back(fileName);
+        m_requests.push(Request{ priority, m_nextSequence++, std::string(fileName), tClock::now(), std::move(complete) });
+    }
+    m_wake.notify_one();
+}
+
+
+std::future<FileBuffer> AsyncFileLoader::Read(const char* fileName, LoadPriority priority) {
+    // std::function needs a copyable callback, hence the shared promise
+    auto promise = std::make_shared<std::promise<FileBuffer>>();
+    std::future<FileBuffer> result = promise->get_future();
+    Queue(fileName, priority, [promise](FileBuffer& file) { promise->set_value(std::move(file)); });
+    return result;
+}
+
+
+void AsyncFileLoader::Read(const char* fileName, tFileCallback callback, LoadPriority priority) {
+    Queue(fileName, priority, std::move(callback));
+}
+
+
+std::future<TextFile> AsyncFileLoader::ReadLines(const char* fileName, TextFileLoader::tLineFilter filter, LoadPriority priority) {
+    auto promise = std::make_shared<std::promise<TextFile>>();
+    std::future<TextFile> result = promise->get_future();
+    ReadLines(fileName, filter, [promise](TextFile& text) { promise->set_value(std::move(text)); }, priority);
+    return result;
+}
+
+
+void AsyncFileLoader::ReadLines(const char* fileName, TextFileLoader::tLineFilter filter, tTextCallback callback, LoadPriority priority) {
+    Queue(fileName, priority, [filter, callback](FileBuffer& file) {
+        TRACE_ZONE("AsyncFileLoader::ParseLines");
+        TextFile text;
+        text.m_error = file.m_error;
+        if (file.IsValid()) {
+            TextFileLoader loader;
+            text.m_dimensions = loader.ParseLines(file.m_data.data(), file.m_data.size(), text.m_lines, filter);
+        }
+        callback(text);
+    });
+}
+
+// =================================================================================================
+
+void AsyncFileLoader::Load(const Request& request, FileBuffer& file) {
+    TRACE_ZONE("AsyncFileLoader::Load");
+#ifdef _WIN32
+    FILE* f = fopen(request.m_fileName.c_str(), "rb");
+    if (not f) {
+        file.m_error = errno;
+        return;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    file.m_data.resize(size_t(std::max(size, 0L)));
+    if (fread(file.m_data.data(), 1, file.m_data.size(), f) != file.m_data.size())
+        file.m_error = EIO;
+    fclose(f);
+#else
+    int fd = open(request.m_fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        file.m_error = errno;
+        return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        file.m_error = errno;
+        close(fd);
+        return;
+    }
+#   ifndef __APPLE__
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#   endif
+    file.m_data.resize(size_t(info.st_size));
+    size_t offset = 0;
+    while (offset < file.m_data.size()) {
+        ssize_t n = read(fd, file.m_data.data() + offset, file.m_data.size() - offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            file.m_error = errno;
+            break;
+        }
+        if (n == 0) { // the file shrank meanwhile
+            file.m_data.resize(offset);
+            break;
+        }
+        offset += size_t(n);
+    }
+    close(fd);
+#endif
+}
+
+
+void AsyncFileLoader::Run(void) {
+    TRACE_THREAD_NAME("file loader");
+    for (;;) {
+        Request request;
+        std::string hint;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_wake.wait(lock, [this]() { return not m_isRunning or not m_requests.empty() or not m_hints.empty(); });
+            if (not m_isRunning)
+                return;
+            // a Now load goes before the hints, the others after them
+            if (not m_requests.empty() and (m_hints.empty() or (m_requests.top().m_priority == LoadPriority::Now))) {
+                request = std::move(const_cast<Request&>(m_requests.top()));
+                m_requests.pop();
+            }
+            else {
+                hint = std::move(m_hints.front());
+                m_hints.pop_front();
+            }
+        }
+        if (not hint.empty()) {
+            TRACE_ZONE("AsyncFileLoader::Hint");
+            Hint(hint);
+            continue;
+        }
+        tClock::time_point start = tClock::now();
+        m_waitTime[int(request.m_priority)].Record(uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(start - request.m_queued).count()));
+        FileBuffer file;
+        Load(request, file);
+        m_readTime.Record(uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(tClock::now() - start).count()));
+        if (file.IsValid()) {
+            m_loaded.fetch_add(1, std::memory_order_relaxed);
+            m_bytes.fetch_add(file.m_data.size(), std::memory_order_relaxed);
+        }
+        else
+            m_failed.fetch_add(1, std::memory_order_relaxed);
+        request.m_complete(file);
+    }
+}
+
+// =================================================================================================
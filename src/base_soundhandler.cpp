@@ -1,6 +1,13 @@
 
 #include "arghandler.h"
 #include "base_soundhandler.h"
+#include "jobsystem.h"
+#include "tracing.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
 
 // =================================================================================================
 
@@ -75,19 +82,43 @@ bool BaseSoundHandler::Setup(String soundFolder) {
 
 
 // preload sound data. Sound data is kept in a dictionary. The sound name is the key to it.
+// The files are read in parallel on the job system. Decoding them (Mix_LoadWAV_RW from memory) and
+// filling the dictionary happen on the calling thread, as SDL_mixer doesn't document its loaders
+// as safe to call from several threads at once.
 bool BaseSoundHandler::LoadSounds(String soundFolder) {
+    TRACE_ZONE("BaseSoundHandler::LoadSounds");
     List<String> soundNames;
     if (0 == GetSoundNames(soundNames))
         return false;
+    std::vector<String*> names;
+    for (auto& name : soundNames)
+        names.push_back(&name);
+    std::vector<std::string> files(names.size());
+    std::vector<bool> isRead(names.size(), false);
+    jobSystem.ParallelFor(0, names.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            TRACE_ZONE("BaseSoundHandler::ReadSound");
+            String fileName = soundFolder + *names[i] + ".wav";
+            std::ifstream stream(fileName.Data(), std::ios::binary);
+            if (not stream.is_open())
+                continue;
+            stream.seekg(0, std::ios::end);
+            files[i].resize(size_t(std::max<std::streamoff>(0, stream.tellg())));
+            stream.seekg(0, std::ios::beg);
+            stream.read(files[i].data(), std::streamsize(files[i].length()));
+            isRead[i] = bool(stream);
+        }
+    });
     bool isComplete = true;
-    for (auto& name : soundNames) {
-        String fileName = soundFolder + name + ".wav";
-        Mix_Chunk* sound = Mix_LoadWAV (fileName.Data());
+    for (size_t i = 0; i < names.size(); i++) {
+        TRACE_ZONE("Mix_LoadWAV_RW");
+        Mix_Chunk* sound = isRead[i] ? Mix_LoadWAV_RW(SDL_RWFromConstMem(files[i].data(), int(files[i].length())), 1) : nullptr;
+        std::string().swap(files[i]);   // the chunk holds the converted samples
         if (sound)
-            m_sounds.Insert(name, sound);
+            m_sounds.Insert(*names[i], sound);
         else {
+            fprintf(stderr, "Couldn't load sound '%s' (%s)\n", names[i]->Data(), isRead[i] ? Mix_GetError() : "file not readable");
             isComplete = false;
-            fprintf(stderr, "Couldn't load sound '%s' (%s)\n", name.Data(), Mix_GetError());
         }
     }
     return isComplete;
@@ -118,7 +149,7 @@ SoundObject& BaseSoundHandler::GetChannel(void) {
     else {
         m_busyChannels[0].Stop();
         m_busyChannels.Append(m_busyChannels.First());
-        m_idleChannels.DiscardFirst();
+        m_busyChannels.DiscardFirst();
     }
     return m_busyChannels[-1];
 }
@@ -193,6 +224,7 @@ void BaseSoundHandler::FadeOut(int id, int fadeTime) {
 
 // cleanup expired channels and update sound volumes
 void BaseSoundHandler::Update(void) {
+    TRACE_ZONE("BaseSoundHandler::Update");
     Cleanup();
     for (auto& so : m_busyChannels)
         UpdateSound(so);
@@ -0,0 +1,249 @@
+#include <stdlib.h>
+#include <string_view>
+
+#include "deltacodec.h"
+
+// =================================================================================================
+
+static void SplitValues(std::string_view text, std::vector<std::string_view>& values) {
+    values.clear();
+    if (text.empty())
+        return;
+    for (;;) {
+        size_t l = text.find(';');
+        values.push_back(text.substr(0, l));
+        if (l == std::string_view::npos)
+            break;
+        text.remove_prefix(l + 1);
+    }
+}
+
+
+bool DeltaCodec::Transmit(const UDPPeer& peer, const String& message) {
+    if (not peer.IsValid())
+        return false;
+    PeerState& state = m_peers[peer.m_target.Key()];
+    std::string encoded;
+    state.m_rawBytes += message.Length();
+    if (not Encode(state, message.Data(), message.Length(), encoded)) {
+        state.m_encodedBytes += message.Length();
+        return m_udp.Transmit(peer, message);
+    }
+    state.m_encodedBytes += encoded.length();
+    return m_udp.Transmit(peer, encoded.data(), encoded.length());
+}
+
+
+bool DeltaCodec::Encode(PeerState& peer, const char* message, size_t length, std::string& encoded) {
+    std::string_view text(message, length);
+    size_t hash = text.find('#');
+    if (hash == std::string_view::npos)
+        return false;
+    std::string_view keyword = text.substr(0, hash);
+    auto k = m_keywords.find(std::string(keyword));
+    if (k == m_keywords.end())
+        return false;
+    size_t keyFields = size_t(k->second);
+    std::vector<std::string_view> values;
+    SplitValues(text.substr(hash + 1), values);
+    if (values.size() <= keyFields)
+        return false;
+
+    std::string stateKey(keyword);
+    for (size_t i = 0; i < keyFields; i++)
+        (stateKey += ';') += values[i];
+    StateHistory& history = peer.m_sent[stateKey];
+    State* base = history.Find(history.m_ackedSequence);
+    size_t fieldCount = values.size() - keyFields;
+    if (base and ((base->m_values.size() != values.size()) or (fieldCount > DELTA_MAX_FIELDS)))
+        base = nullptr;
+
+    uint32_t sequence = peer.m_nextSequence++;
+    if (sequence == 0) // 0 means "nothing acked"
+        sequence = peer.m_nextSequence++;
+    uint64_t mask = 0;
+    if (base)
+        for (size_t i = 0; i < fieldCount; i++)
+            if (base->m_values[keyFields + i] != values[keyFields + i])
+                mask |= uint64_t(1) << i;
+
+    char header[64];
+    if (base)
+        snprintf(header, sizeof(header), "!%x:%x:%llx", sequence, sequence - base->m_sequence, (unsigned long long) mask);
+    else
+        snprintf(header, sizeof(header), "@%u:%x", unsigned(m_udp.InPort()), sequence);
+    encoded.reserve(length + 32);
+    ((encoded = keyword) += '#') += header;
+    for (size_t i = 0; i < values.size(); i++)
+        if ((i < keyFields) or not base or (mask & (uint64_t(1) << (i - keyFields))))
+            (encoded += ';') += values[i];
+
+    uint32_t overwritten = history.Slot(sequence).m_sequence;
+    if (overwritten != 0)
+        peer.m_sentBySequence.erase(overwritten);
+    State& state = history.Add(sequence);
+    state.m_values.assign(values.begin(), values.end());
+    peer.m_sentBySequence[sequence] = &history;
+    if (base)
+        ++m_deltaStates;
+    else
+        ++m_fullStates;
+    return true;
+}
+
+
+void DeltaCodec::Acknowledge(PeerState& peer, uint32_t sequence) {
+    auto it = peer.m_sentBySequence.find(sequence);
+    if (it == peer.m_sentBySequence.end())
+        return;
+    StateHistory* history = it->second;
+    peer.m_sentBySequence.erase(it);
+    if (history->Find(sequence) and (sequence > history->m_ackedSequence))
+        history->m_ackedSequence = sequence;
+}
+
+
+DeltaCodec::tResult DeltaCodec::Decode(Message& message) {
+    std::string_view text(message.Payload(), message.PayloadLength());
+    std::string_view keyword = message.Keyword();
+    if (keyword.length() == text.length())
+        return tResult::Passed;
+    std::vector<std::string_view> values;
+    SplitValues(text.substr(keyword.length() + 1), values);
+    UDPAddress sender;
+    if (values.empty() or not sender.ParseHost(message.Address()))
+        return tResult::Passed;
+
+    if (keyword == "@dack") {
+        sender.SetPort(uint16_t(strtoul(values[0].data(), nullptr, 10)));
+        PeerState& peer = m_peers[sender.Key()];
+        for (size_t i = 1; i < values.size(); i++)
+            Acknowledge(peer, uint32_t(strtoul(values[i].data(), nullptr, 10)));
+        return tResult::Consumed;
+    }
+
+    auto k = m_keywords.find(std::string(keyword));
+    if ((k == m_keywords.end()) or values[0].empty() or ((values[0][0] != '@') and (values[0][0] != '!')))
+        return tResult::Passed;
+    size_t keyFields = size_t(k->second);
+    if (values.size() <= keyFields)
+        return tResult::Passed;
+
+    // header
+    char* s = const_cast<char*>(values[0].data());
+    bool isDelta = (*s == '!');
+    UDPAddress source(sender.m_host);
+    source.SetPort(message.m_port);
+    uint16_t port = 0;
+    uint32_t sequence, baseSequence = 0;
+    uint64_t mask = 0;
+    if (isDelta) {
+        auto it = m_senders.find(source.Key());
+        if (it == m_senders.end()) {
+            ++m_undecodable;
+            return tResult::Dropped;
+        }
+        sender.m_port = uint16_t(it->second & 0xFFFF); // the peer key holds the announced receive port
+        port = sender.Port();
+        sequence = uint32_t(strtoul(s + 1, &s, 16));
+        baseSequence = sequence - uint32_t(strtoul(s + 1, &s, 16));
+        mask = strtoull(s + 1, &s, 16);
+    }
+    else {
+        port = uint16_t(strtoul(s + 1, &s, 10));
+        sequence = uint32_t(strtoul(s + 1, &s, 16));
+        sender.SetPort(port);
+        m_senders[source.Key()] = sender.Key();
+    }
+    PeerState& peer = m_peers[sender.Key()];
+
+    std::string stateKey(keyword);
+    for (size_t i = 1; i <= keyFields; i++)
+        (stateKey += ';') += values[i];
+    StateHistory& history = peer.m_received[stateKey];
+    std::vector<std::string> rebuilt;
+    if (not isDelta)
+        rebuilt.assign(values.begin() + 1, values.end());
+    else {
+        State* base = history.Find(baseSequence);
+        if (not base) {
+            ++m_undecodable;
+            return tResult::Dropped;
+        }
+        rebuilt = base->m_values;
+        size_t next = 1 + keyFields;
+        for (size_t i = 0; (i < rebuilt.size() - keyFields) and (i < DELTA_MAX_FIELDS); i++)
+            if (mask & (uint64_t(1) << i)) {
+                if (next >= values.size()) {
+                    ++m_undecodable;
+                    return tResult::Dropped;
+                }
+                rebuilt[keyFields + i] = values[next++];
+            }
+    }
+    history.Add(sequence).m_values = rebuilt;
+    peer.m_pendingAcks.push_back(sequence);
+    if (not peer.m_replyPeer.IsValid()) {
+        char host[16];
+        sender.FormatHost(host);
+        peer.m_replyPeer.Resolve(String(host), port);
+    }
+
+    std::string decoded(keyword);
+    decoded += '#';
+    for (size_t i = 0; i < rebuilt.size(); i++) {
+        if (i)
+            decoded += ';';
+        decoded += rebuilt[i];
+    }
+    char address[16];
+    sender.FormatHost(address);
+    message.Assign(decoded.data(), decoded.length(), address, message.m_port);
+    return tResult::Decoded;
+}
+
+
+bool DeltaCodec::Receive(Message& message) {
+    for (;;) {
+        message = m_udp.Receive();
+        if (message.IsEmpty())
+            return false;
+        tResult result = Decode(message);
+        if ((result == tResult::Passed) or (result == tResult::Decoded))
+            return true;
+    }
+}
+
+
+int DeltaCodec::Flush(void) {
+    int n = 0;
+    std::string ack;
+    for (auto& [key, peer] : m_peers) {
+        if (peer.m_pendingAcks.empty() or not peer.m_replyPeer.IsValid())
+            continue;
+        ack = "@dack#" + std::to_string(m_udp.InPort());
+        for (uint32_t sequence : peer.m_pendingAcks) {
+            if (ack.length() > UDP_MAX_DATAGRAM_SIZE / 2) {
+                m_udp.Queue(peer.m_replyPeer.m_target, ack.data(), ack.length());
+                ack = "@dack#" + std::to_string(m_udp.InPort());
+                ++n;
+            }
+            (ack += ';') += std::to_string(sequence);
+        }
+        m_udp.Queue(peer.m_replyPeer.m_target, ack.data(), ack.length());
+        peer.m_pendingAcks.clear();
+        ++n;
+    }
+    m_udp.Flush();
+    return n;
+}
+
+
+float DeltaCodec::Ratio(const UDPPeer& peer) {
+    auto it = m_peers.find(peer.m_target.Key());
+    if ((it == m_peers.end()) or (it->second.m_rawBytes == 0))
+        return 1.0f;
+    return float(it->second.m_encodedBytes) / float(it->second.m_rawBytes);
+}
+
+// =================================================================================================
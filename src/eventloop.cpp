@@ -0,0 +1,378 @@
+#include <thread>
+#include <algorithm>
+
+#include "eventloop.h"
+
+#if USE_POSIX_SOCKETS
+#   include <errno.h>
+#   include <unistd.h>
+#   ifdef __linux__
+#       include <sys/epoll.h>
+#       include <sys/eventfd.h>
+#       include <sys/timerfd.h>
+#   else
+#       include <fcntl.h>
+#       include <poll.h>
+#   endif
+#endif
+
+// =================================================================================================
+
+#if USE_POSIX_SOCKETS
+#   ifdef __linux__
+
+EventLoop::EventLoop()
+    : m_nextTimerId(1), m_isRunning(true), m_wakeups(0), m_socketEvents(0), m_timerEvents(0)
+{
+    m_epoll = epoll_create1(EPOLL_CLOEXEC);
+    m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((m_epoll < 0) or (m_timerFd < 0) or (m_wakeFd < 0)) {
+        fprintf(stderr, "EventLoop: couldn't create epoll instance (%s)\n", strerror(errno));
+        return;
+    }
+    // the timer and wake descriptors are told apart from sockets by their data pointer
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &m_timerFd;
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_timerFd, &event);
+    event.data.ptr = &m_wakeFd;
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeFd, &event);
+}
+
+
+EventLoop::~EventLoop() {
+    for (int fd : { m_wakeFd, m_timerFd, m_epoll })
+        if (fd >= 0)
+            close(fd);
+}
+
+
+bool EventLoop::AddSocket(UDPSocket& socket, tSocketHandler handler) {
+    if (not socket.m_isValid or (m_epoll < 0))
+        return false;
+    std::unique_ptr<Watch> watch(new Watch{ &socket, std::move(handler) });
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = watch.get();
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket.m_socket, &event) < 0) {
+        fprintf(stderr, "EventLoop: couldn't watch socket (%s)\n", strerror(errno));
+        return false;
+    }
+    m_watches.push_back(std::move(watch));
+    return true;
+}
+
+
+void EventLoop::Unwatch(UDPSocket& socket) {
+    epoll_ctl(m_epoll, EPOLL_CTL_DEL, socket.m_socket, nullptr);
+}
+
+
+// Timers are handled in RunTimers(); the timerfd only makes epoll_wait return at the deadline
+// with microsecond instead of millisecond precision.
+int EventLoop::Wait(int maxWait) {
+    tClock::time_point deadline = NextDeadline();
+    if (deadline != m_armedDeadline) {
+        struct itimerspec spec = {};
+        if (deadline != tClock::time_point()) {
+            int64_t delay = std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - tClock::now()).count());
+            spec.it_value.tv_sec = time_t(delay / 1000000000);
+            spec.it_value.tv_nsec = long(delay % 1000000000);
+        }
+        timerfd_settime(m_timerFd, 0, &spec, nullptr);
+        m_armedDeadline = deadline;
+    }
+    struct epoll_event events[64];
+    int count = epoll_wait(m_epoll, events, 64, maxWait);
+    if (count < 0)
+        return (errno == EINTR) ? 0 : -1;
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        uint64_t value;
+        if (events[i].data.ptr == &m_timerFd) {
+            if (read(m_timerFd, &value, sizeof(value)) > 0)
+                m_armedDeadline = tClock::time_point();
+        }
+        else if (events[i].data.ptr == &m_wakeFd)
+            (void) read(m_wakeFd, &value, sizeof(value));
+        else
+            n += Dispatch(*static_cast<Watch*>(events[i].data.ptr));
+    }
+    return n;
+}
+
+
+void EventLoop::Wake(void) {
+    uint64_t value = 1;
+    (void) write(m_wakeFd, &value, sizeof(value));
+}
+
+#   else // other POSIX systems
+
+EventLoop::EventLoop()
+    : m_nextTimerId(1), m_isRunning(true), m_wakeups(0), m_socketEvents(0), m_timerEvents(0)
+{
+    if (pipe(m_wakePipe) < 0) {
+        fprintf(stderr, "EventLoop: couldn't create wake pipe (%s)\n", strerror(errno));
+        m_wakePipe[0] = m_wakePipe[1] = -1;
+        return;
+    }
+    for (int fd : m_wakePipe)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+
+EventLoop::~EventLoop() {
+    for (int fd : m_wakePipe)
+        if (fd >= 0)
+            close(fd);
+}
+
+
+bool EventLoop::AddSocket(UDPSocket& socket, tSocketHandler handler) {
+    if (not socket.m_isValid)
+        return false;
+    m_watches.push_back(std::unique_ptr<Watch>(new Watch{ &socket, std::move(handler) }));
+    return true;
+}
+
+
+void EventLoop::Unwatch(UDPSocket& socket) {
+    (void) socket;
+}
+
+
+int EventLoop::Wait(int maxWait) {
+    std::vector<struct pollfd> fds;
+    fds.reserve(m_watches.size() + 1);
+    fds.push_back({ m_wakePipe[0], POLLIN, 0 });
+    for (auto& watch : m_watches)
+        fds.push_back({ watch->m_socket->m_socket, POLLIN, 0 });
+    int count = poll(fds.data(), nfds_t(fds.size()), WaitTime(maxWait));
+    if (count <= 0)
+        return ((count < 0) and (errno != EINTR)) ? -1 : 0;
+    char buffer[64];
+    if (fds[0].revents)
+        while (read(m_wakePipe[0], buffer, sizeof(buffer)) > 0)
+            ;
+    // handlers may add or remove sockets, so only the watches polled are looked at
+    std::vector<Watch*> ready;
+    for (size_t i = 1; i < fds.size(); i++)
+        if (fds[i].revents)
+            ready.push_back(m_watches[i - 1].get());
+    int n = 0;
+    for (Watch* watch : ready)
+        n += Dispatch(*watch);
+    return n;
+}
+
+
+void EventLoop::Wake(void) {
+    char c = 1;
+    (void) write(m_wakePipe[1], &c, 1);
+}
+
+#   endif
+#else // SDL_net
+
+EventLoop::EventLoop()
+    : m_nextTimerId(1), m_isRunning(true), m_socketSet(nullptr), m_socketSetSize(0), m_wakeups(0), m_socketEvents(0), m_timerEvents(0)
+{ }
+
+
+EventLoop::~EventLoop() {
+    if (m_socketSet)
+        SDLNet_FreeSocketSet(m_socketSet);
+}
+
+
+bool EventLoop::AddSocket(UDPSocket& socket, tSocketHandler handler) {
+    if (not socket.m_isValid)
+        return false;
+    // SDL_net socket sets have a fixed size, so a full set is replaced by one twice as big
+    if (int(m_watches.size()) >= m_socketSetSize) {
+        int size = std::max(8, 2 * m_socketSetSize);
+        SDLNet_SocketSet socketSet = SDLNet_AllocSocketSet(size);
+        if (not socketSet) {
+            fprintf(stderr, "EventLoop: couldn't allocate socket set (%s)\n", SDLNet_GetError());
+            return false;
+        }
+        for (auto& watch : m_watches)
+            SDLNet_UDP_AddSocket(socketSet, watch->m_socket->m_socket);
+        if (m_socketSet)
+            SDLNet_FreeSocketSet(m_socketSet);
+        m_socketSet = socketSet;
+        m_socketSetSize = size;
+    }
+    if (SDLNet_UDP_AddSocket(m_socketSet, socket.m_socket) < 0) {
+        fprintf(stderr, "EventLoop: couldn't watch socket (%s)\n", SDLNet_GetError());
+        return false;
+    }
+    m_watches.push_back(std::unique_ptr<Watch>(new Watch{ &socket, std::move(handler) }));
+    return true;
+}
+
+
+void EventLoop::Unwatch(UDPSocket& socket) {
+    SDLNet_UDP_DelSocket(m_socketSet, socket.m_socket);
+}
+
+
+int EventLoop::Wait(int maxWait) {
+    int timeout = WaitTime(maxWait);
+    if (m_watches.empty()) {
+        if (timeout > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+        return 0;
+    }
+    int count = SDLNet_CheckSockets(m_socketSet, (timeout < 0) ? ~Uint32(0) : Uint32(timeout));
+    if (count <= 0)
+        return count;
+    std::vector<Watch*> ready;
+    for (auto& watch : m_watches)
+        if (SDLNet_SocketReady(watch->m_socket->m_socket))
+            ready.push_back(watch.get());
+    int n = 0;
+    for (Watch* watch : ready)
+        n += Dispatch(*watch);
+    return n;
+}
+
+
+void EventLoop::Wake(void) {
+}
+
+#endif
+
+// =================================================================================================
+
+bool EventLoop::RemoveSocket(UDPSocket& socket) {
+    auto it = std::find_if(m_watches.begin(), m_watches.end(), [&socket](const std::unique_ptr<Watch>& w) { return w->m_socket == &socket; });
+    if (it == m_watches.end())
+        return false;
+    Unwatch(socket);
+    // events for it may still be pending in the current dispatch round, so it is only deleted after that
+    (*it)->m_socket = nullptr;
+    m_removed.push_back(std::move(*it));
+    m_watches.erase(it);
+    return true;
+}
+
+
+int EventLoop::Dispatch(Watch& watch) {
+    if (not watch.m_socket)
+        return 0;
+    ++m_socketEvents;
+    watch.m_handler(*watch.m_socket);
+    return 1;
+}
+
+// =================================================================================================
+
+int EventLoop::AddTimer(int delay, tTimerHandler handler, bool repeat) {
+    return ScheduleTimer(std::chrono::milliseconds(delay), std::move(handler), repeat);
+}
+
+
+int EventLoop::ScheduleTimer(std::chrono::microseconds delay, tTimerHandler handler, bool repeat) {
+    int id = m_nextTimerId++;
+    int64_t interval = repeat ? std::max<int64_t>(1, delay.count()) : 0;
+    m_timers.push(Timer{ tClock::now() + delay, id, interval });
+    m_timerHandlers.emplace(id, std::move(handler));
+    return id;
+}
+
+
+void EventLoop::CancelTimer(int id) {
+    m_timerHandlers.erase(id);    // its heap entry is skipped when it comes up
+}
+
+
+EventLoop::tClock::time_point EventLoop::NextDeadline(void) {
+    while (not m_timers.empty() and (m_timerHandlers.find(m_timers.top().m_id) == m_timerHandlers.end()))
+        m_timers.pop();
+    return m_timers.empty() ? tClock::time_point() : m_timers.top().m_deadline;
+}
+
+
+int EventLoop::WaitTime(int maxWait) {
+    tClock::time_point deadline = NextDeadline();
+    if (deadline == tClock::time_point())
+        return maxWait;
+    // round up so the wait doesn't end just before the deadline
+    int64_t delay = std::chrono::duration_cast<std::chrono::microseconds>(deadline - tClock::now()).count();
+    int wait = (delay <= 0) ? 0 : int(std::min<int64_t>((delay + 999) / 1000, INT32_MAX));
+    return ((maxWait >= 0) and (maxWait < wait)) ? maxWait : wait;
+}
+
+
+// A repeating timer keeps its cadence (next deadline = last deadline + interval) unless it fell
+// more than an interval behind, in which case the missed calls are skipped.
+int EventLoop::RunTimers(void) {
+    tClock::time_point now = tClock::now();
+    int n = 0;
+    while (not m_timers.empty() and (m_timers.top().m_deadline <= now)) {
+        Timer timer = m_timers.top();
+        m_timers.pop();
+        auto it = m_timerHandlers.find(timer.m_id);
+        if (it == m_timerHandlers.end())
+            continue;
+        // the handler may cancel its own or add other timers, so it is called through a copy
+        tTimerHandler handler;
+        int64_t lateness = std::chrono::duration_cast<std::chrono::microseconds>(tClock::now() - timer.m_deadline).count();
+        if (timer.m_interval) {
+            handler = it->second;
+            timer.m_deadline += std::chrono::microseconds(timer.m_interval);
+            if (timer.m_deadline <= now)
+                timer.m_deadline = now + std::chrono::microseconds(timer.m_interval);
+            m_timers.push(timer);
+        }
+        else {
+            handler = std::move(it->second);
+            m_timerHandlers.erase(it);
+        }
+        m_timerLateness.Record(uint64_t(std::max<int64_t>(lateness, 0)));
+        ++m_timerEvents;
+        ++n;
+        handler();
+    }
+    return n;
+}
+
+
+int EventLoop::RunOnce(int maxWait) {
+    int n = Wait(maxWait);
+    ++m_wakeups;
+    if (n < 0)
+        return -1;
+    n += RunTimers();
+    m_removed.clear();
+    return n;
+}
+
+
+// the flag is left alone here, so a Stop() from another thread before Run() starts isn't lost
+void EventLoop::Run(void) {
+    while (m_isRunning) {
+#if USE_POSIX_SOCKETS
+        if (RunOnce(-1) < 0)
+#else
+        if (RunOnce(100) < 0)   // Stop() can't interrupt SDLNet_CheckSockets
+#endif
+            break;
+    }
+}
+
+
+void EventLoop::Start(void) {
+    m_isRunning = true;
+}
+
+
+void EventLoop::Stop(void) {
+    m_isRunning = false;
+    Wake();
+}
+
+// =================================================================================================
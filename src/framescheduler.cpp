@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <algorithm>
+#include <thread>
+
+#include "framescheduler.h"
+#include "tracing.h"
+
+// =================================================================================================
+
+static inline int64_t Microseconds(FrameScheduler::tClock::duration d) {
+    return int64_t(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+}
+
+
+FrameScheduler::FrameScheduler(int frameRate)
+    : m_frameInterval(1000000 / std::max(frameRate, 1)), m_nextId(1), m_frames(0), m_frameOverruns(0)
+{ }
+
+
+int FrameScheduler::Add(const char* name, FrameTask::tUpdate update, int rate, int budget, int maxCatchUp) {
+    int64_t interval = (rate > 0) ? std::max<int64_t>(1000000 / rate, 1) : 0;
+    m_tasks.emplace_back(new FrameTask(m_nextId, name, update, interval, std::max(budget, 0), std::max(maxCatchUp, 1)));
+    return m_nextId++;
+}
+
+
+bool FrameScheduler::Remove(int id) {
+    auto it = std::find_if(m_tasks.begin(), m_tasks.end(), [id](const std::unique_ptr<FrameTask>& task) { return task->m_id == id; });
+    if (it == m_tasks.end())
+        return false;
+    m_tasks.erase(it);
+    return true;
+}
+
+
+FrameTask* FrameScheduler::Task(int id) {
+    for (auto& task : m_tasks)
+        if (task->m_id == id)
+            return task.get();
+    return nullptr;
+}
+
+
+void FrameScheduler::Run(FrameTask& task, tClock::time_point now, int64_t elapsed) {
+    TRACE_ZONE(task.m_name);
+    tClock::time_point deadline = task.m_budget ? now + std::chrono::microseconds(task.m_budget) : tClock::time_point::max();
+    bool isLate = false;
+    if (task.m_interval == 0) {
+        bool more;
+        do {
+            more = task.m_update(deadline);
+            ++task.m_steps;
+        } while (more and (tClock::now() < deadline));
+        isLate = more;
+    }
+    else {
+        task.m_accumulator += elapsed;
+        int64_t limit = task.m_interval * task.m_maxCatchUp;
+        if (task.m_accumulator > limit) {
+            task.m_skipped += uint64_t((task.m_accumulator - limit) / task.m_interval);
+            task.m_accumulator = limit + task.m_accumulator % task.m_interval;
+        }
+        // the first due step always runs, so a task with a too small budget still makes progress
+        for (int steps = 0; task.m_accumulator >= task.m_interval; steps++) {
+            if ((steps > 0) and (tClock::now() >= deadline)) {
+                isLate = true;
+                break;
+            }
+            task.m_update(deadline);
+            task.m_accumulator -= task.m_interval;
+            ++task.m_steps;
+        }
+    }
+    if (isLate)
+        ++task.m_deferred;
+    int64_t time = Microseconds(tClock::now() - now);
+    task.m_time.Record(uint64_t(time));
+    if (task.m_budget and (time > task.m_budget)) {
+        ++task.m_overruns;
+        if (m_onOverrun)
+            m_onOverrun(task, time);
+    }
+}
+
+
+int64_t FrameScheduler::RunFrame(void) {
+    TRACE_ZONE("FrameScheduler::RunFrame");
+    tClock::time_point start = tClock::now();
+    int64_t elapsed = (m_frames == 0) ? m_frameInterval : Microseconds(start - m_lastFrame);
+    m_lastFrame = start;
+    for (size_t i = 0; i < m_tasks.size(); i++)
+        Run(*m_tasks[i], tClock::now(), elapsed);
+    int64_t time = Microseconds(tClock::now() - start);
+    ++m_frames;
+    m_frameTime.Record(uint64_t(time));
+    if (time > m_frameInterval)
+        ++m_frameOverruns;
+    return time;
+}
+
+
+void FrameScheduler::WaitForNextFrame(void) {
+    tClock::time_point now = tClock::now();
+    m_nextFrame += std::chrono::microseconds(m_frameInterval);
+    // more than a frame behind: start over from now instead of rushing through the missed frames
+    if (m_nextFrame + std::chrono::microseconds(m_frameInterval) < now)
+        m_nextFrame = now;
+    else if (m_nextFrame > now)
+        std::this_thread::sleep_until(m_nextFrame);
+}
+
+
+FrameTask::tUpdate FrameScheduler::Drain(std::function<bool(void)> step, int maxItems) {
+    return [step, maxItems](tClock::time_point deadline) {
+        bool hasDeadline = (deadline != tClock::time_point::max());
+        for (int i = 0; i < maxItems; i++) {
+            // the first item always runs, like the first step of a task
+            if ((i > 0) and hasDeadline and (tClock::now() >= deadline))
+                return true;
+            if (not step())
+                return false;
+        }
+        return true;
+    };
+}
+
+// =================================================================================================
+
+std::string FrameScheduler::ToText(void) const {
+    std::string text;
+    char line[320];
+    snprintf(line, sizeof(line), "frames %llu, over %lld us: %llu, time p50 %llu p99 %llu max %llu us\n",
+             (unsigned long long) m_frames, (long long) m_frameInterval, (unsigned long long) m_frameOverruns,
+             (unsigned long long) m_frameTime.Percentile(0.5), (unsigned long long) m_frameTime.Percentile(0.99), (unsigned long long) m_frameTime.Max());
+    text += line;
+    for (const auto& task : m_tasks) {
+        snprintf(line, sizeof(line), "%s: %llu steps, %llu skipped, %llu deferred, %llu overruns (budget %lld us), time p50 %llu p99 %llu max %llu us\n",
+                 task->m_name, (unsigned long long) task->m_steps, (unsigned long long) task->m_skipped, (unsigned long long) task->m_deferred,
+                 (unsigned long long) task->m_overruns, (long long) task->m_budget, (unsigned long long) task->m_time.Percentile(0.5),
+                 (unsigned long long) task->m_time.Percentile(0.99), (unsigned long long) task->m_time.Max());
+        text += line;
+    }
+    return text;
+}
+
+// =================================================================================================
@@ -0,0 +1,128 @@
+#include <algorithm>
+
+#include "jobsystem.h"
+
+// =================================================================================================
+
+// the job system the calling thread is a worker of, and its index there
+static thread_local JobSystem* currentSystem = nullptr;
+static thread_local int currentWorker = -1;
+
+
+JobSystem::JobSystem(int workerCount)
+    : m_isRunning(true), m_queued(0), m_sleeping(0), m_nextWorker(0), m_executed(0), m_stolen(0)
+{
+    if (workerCount <= 0)
+        workerCount = std::max(1, int(std::thread::hardware_concurrency()) - 1);
+    for (int i = 0; i < workerCount; i++)
+        m_workers.emplace_back(new Worker);
+    // the deques must all exist before the first worker looks for something to steal
+    for (int i = 0; i < workerCount; i++)
+        m_workers[i]->m_thread = std::thread(&JobSystem::WorkerLoop, this, i);
+}
+
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_idleLock);
+        m_isRunning.store(false);
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers)
+        if (worker->m_thread.joinable())
+            worker->m_thread.join();
+}
+
+
+void JobSystem::Push(Job&& job) {
+    uint32_t target = (currentSystem == this) ? uint32_t(currentWorker) : m_nextWorker.fetch_add(1, std::memory_order_relaxed) % uint32_t(m_workers.size());
+    Worker& worker = *m_workers[target];
+    {
+        std::lock_guard<std::mutex> lock(worker.m_lock);
+        worker.m_jobs.push_back(std::move(job));
+        m_queued.fetch_add(1);
+    }
+    // pairs with the sleeping count / queue check in WorkerLoop: one of both sides sees the other
+    if (m_sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(m_idleLock);
+        m_wake.notify_one();
+    }
+}
+
+
+void JobSystem::Run(TaskGroup& group, tJob job) {
+    group.m_pending.fetch_add(1, std::memory_order_relaxed);
+    Push(Job{ std::move(job), &group });
+}
+
+
+void JobSystem::Submit(tJob job) {
+    Push(Job{ std::move(job), nullptr });
+}
+
+
+bool JobSystem::RunOne(void) {
+    Job job;
+    bool found = false;
+    int self = (currentSystem == this) ? currentWorker : -1;
+    int count = int(m_workers.size());
+    if (self >= 0) {
+        Worker& worker = *m_workers[self];
+        std::lock_guard<std::mutex> lock(worker.m_lock);
+        if (not worker.m_jobs.empty()) {
+            job = std::move(worker.m_jobs.back());
+            worker.m_jobs.pop_back();
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            found = true;
+        }
+    }
+    if (not found) {
+        // unsigned, so the round robin counter stays a valid index after it passes 2^31
+        uint32_t start = (self >= 0) ? uint32_t(self + 1) : m_nextWorker.load(std::memory_order_relaxed);
+        for (int i = 0; (i < count) and not found; i++) {
+            int victim = int((start + uint32_t(i)) % uint32_t(count));
+            if (victim == self)
+                continue;
+            Worker& worker = *m_workers[victim];
+            std::lock_guard<std::mutex> lock(worker.m_lock);
+            if (not worker.m_jobs.empty()) {
+                job = std::move(worker.m_jobs.front());
+                worker.m_jobs.pop_front();
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                found = true;
+            }
+        }
+        if (found and (self >= 0))
+            m_stolen.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (not found)
+        return false;
+    job.m_job();
+    m_executed.fetch_add(1, std::memory_order_relaxed);
+    if (job.m_group)
+        job.m_group->m_pending.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+
+void JobSystem::Wait(TaskGroup& group) {
+    while (not group.IsDone())
+        if (not RunOne())
+            std::this_thread::yield();  // the remaining jobs of group are running elsewhere
+}
+
+
+void JobSystem::WorkerLoop(int index) {
+    currentSystem = this;
+    currentWorker = index;
+    while (m_isRunning.load(std::memory_order_relaxed)) {
+        if (RunOne())
+            continue;
+        std::unique_lock<std::mutex> lock(m_idleLock);
+        m_sleeping.fetch_add(1);
+        m_wake.wait(lock, [this]() { return (m_queued.load() > 0) or not m_isRunning.load(); });
+        m_sleeping.fetch_sub(1);
+    }
+}
+
+// =================================================================================================
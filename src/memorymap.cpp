@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "memorymap.h"
+
+#ifndef _WIN32
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
+
+// =================================================================================================
+
+#ifdef _WIN32
+
+bool MemoryMap::Create(const char* name, size_t size) {
+    Close();
+    m_name = std::string("Local\\") + name;
+    m_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, DWORD(uint64_t(size) >> 32), DWORD(size), m_name.c_str());
+    if (not m_handle)
+        return false;
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        CloseHandle(m_handle);
+        m_handle = nullptr;
+        return false;
+    }
+    if (not (m_data = MapViewOfFile(m_handle, FILE_MAP_ALL_ACCESS, 0, 0, size))) {
+        Close();
+        return false;
+    }
+    memset(m_data, 0, size);
+    m_size = size;
+    m_isOwner = true;
+    return true;
+}
+
+
+bool MemoryMap::Open(const char* name) {
+    Close();
+    m_name = std::string("Local\\") + name;
+    if (not (m_handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, m_name.c_str())))
+        return false;
+    if (not (m_data = MapViewOfFile(m_handle, FILE_MAP_ALL_ACCESS, 0, 0, 0))) {
+        Close();
+        return false;
+    }
+    MEMORY_BASIC_INFORMATION info;
+    VirtualQuery(m_data, &info, sizeof(info));
+    m_size = info.RegionSize;
+    return true;
+}
+
+
+bool MemoryMap::OpenFile(const char* path) {
+    Close();
+    m_name = path;
+    m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER size;
+    if ((m_file == INVALID_HANDLE_VALUE) or not GetFileSizeEx(m_file, &size) or (size.QuadPart == 0) or
+        not (m_handle = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr)) or
+        not (m_data = MapViewOfFile(m_handle, FILE_MAP_READ, 0, 0, 0))) {
+        Close();
+        return false;
+    }
+    m_size = size_t(size.QuadPart);
+    return true;
+}
+
+
+bool MemoryMap::Remove(const char* name) {
+    (void) name;
+    return false;
+}
+
+
+void MemoryMap::Close(void) {
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_handle)
+        CloseHandle(m_handle);
+    if (m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file);
+    m_data = nullptr;
+    m_handle = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+    m_size = 0;
+    m_isOwner = false;
+}
+
+#else
+
+bool MemoryMap::Create(const char* name, size_t size) {
+    Close();
+    m_name = std::string("/") + name;
+    if (0 > (m_fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600)))
+        return false;
+    m_isOwner = true;
+    if ((0 > ftruncate(m_fd, off_t(size))) or (MAP_FAILED == (m_data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0)))) {
+        fprintf(stderr, "MemoryMap: couldn't map '%s' (%zu bytes)\n", name, size);
+        m_data = nullptr;
+        Close();
+        return false;
+    }
+    m_size = size;
+    return true;
+}
+
+
+bool MemoryMap::Open(const char* name) {
+    Close();
+    m_name = std::string("/") + name;
+    if (0 > (m_fd = shm_open(m_name.c_str(), O_RDWR, 0)))
+        return false;
+    struct stat info;
+    if ((0 > fstat(m_fd, &info)) or (info.st_size == 0) or (MAP_FAILED == (m_data = mmap(nullptr, size_t(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0)))) {
+        m_data = nullptr;
+        Close();
+        return false;
+    }
+    m_size = size_t(info.st_size);
+    return true;
+}
+
+
+bool MemoryMap::OpenFile(const char* path) {
+    Close();
+    m_name = path;
+    if (0 > (m_fd = open(path, O_RDONLY)))
+        return false;
+    struct stat info;
+    if ((0 > fstat(m_fd, &info)) or (info.st_size == 0) or (MAP_FAILED == (m_data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, m_fd, 0)))) {
+        m_data = nullptr;
+        Close();
+        return false;
+    }
+    m_size = size_t(info.st_size);
+#ifdef MADV_SEQUENTIAL
+    madvise(m_data, m_size, MADV_SEQUENTIAL);
+#endif
+    return true;
+}
+
+
+bool MemoryMap::Remove(const char* name) {
+    return 0 == shm_unlink((std::string("/") + name).c_str());
+}
+
+
+void MemoryMap::Close(void) {
+    if (m_data)
+        munmap(m_data, m_size);
+    if (m_fd >= 0)
+        close(m_fd);
+    if (m_isOwner)
+        shm_unlink(m_name.c_str());
+    m_data = nullptr;
+    m_fd = -1;
+    m_size = 0;
+    m_isOwner = false;
+}
+
+#endif
+
+// =================================================================================================
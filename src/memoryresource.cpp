@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "memoryresource.h"
+
+// =================================================================================================
+
+// function statics, so resources defined at namespace scope can register during static initialization
+static std::mutex& RegistryLock(void) {
+    static std::mutex lock;
+    return lock;
+}
+
+
+static std::vector<CountingResource*>& Registry(void) {
+    static std::vector<CountingResource*> resources;
+    return resources;
+}
+
+// =================================================================================================
+
+CountingResource::CountingResource(const char* name, std::pmr::memory_resource* upstream)
+    : m_name(name), m_upstream(upstream ? upstream : std::pmr::get_default_resource())
+{
+    MemoryResources::Register(this);
+}
+
+
+CountingResource::~CountingResource() {
+    MemoryResources::Unregister(this);
+}
+
+
+void* CountingResource::do_allocate(size_t bytes, size_t alignment) {
+    void* p = m_upstream->allocate(bytes, alignment);
+    m_stats.Allocated(bytes);
+    return p;
+}
+
+
+void CountingResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    m_upstream->deallocate(p, bytes, alignment);
+    m_stats.Freed(bytes);
+}
+
+// =================================================================================================
+
+ArenaResource::ArenaResource(const char* name, size_t initialSize, std::pmr::memory_resource* upstream)
+    : CountingResource(name, &m_arena), m_arena(std::max<size_t>(initialSize, 1), upstream ? upstream : std::pmr::get_default_resource())
+{ }
+
+
+ArenaResource::ArenaResource(const char* name, void* buffer, size_t size, std::pmr::memory_resource* upstream)
+    : CountingResource(name, &m_arena), m_arena(buffer, size, upstream ? upstream : std::pmr::get_default_resource())
+{ }
+
+
+// memory is only returned by Release, but the bytes count as no longer in use
+void ArenaResource::do_deallocate(void*, size_t bytes, size_t) {
+    m_stats.Freed(bytes);
+}
+
+
+void ArenaResource::Release(void) {
+    m_arena.release();
+    m_stats.m_bytesInUse.store(0, std::memory_order_relaxed);
+}
+
+// =================================================================================================
+
+PoolResource::PoolResource(const char* name, bool isShared, size_t maxBlockSize, std::pmr::memory_resource* upstream)
+    : CountingResource(name)
+{
+    std::pmr::pool_options options;
+    options.largest_required_pool_block = maxBlockSize;
+    if (not upstream)
+        upstream = std::pmr::get_default_resource();
+    if (isShared) {
+        m_sharedPool.reset(new std::pmr::synchronized_pool_resource(options, upstream));
+        m_upstream = m_sharedPool.get();
+    }
+    else {
+        m_localPool.reset(new std::pmr::unsynchronized_pool_resource(options, upstream));
+        m_upstream = m_localPool.get();
+    }
+}
+
+
+void PoolResource::Release(void) {
+    if (m_sharedPool)
+        m_sharedPool->release();
+    else
+        m_localPool->release();
+    m_stats.m_bytesInUse.store(0, std::memory_order_relaxed);
+}
+
+// =================================================================================================
+
+void MemoryResources::Register(CountingResource* resource) {
+    std::lock_guard<std::mutex> lock(RegistryLock());
+    Registry().push_back(resource);
+}
+
+
+void MemoryResources::Unregister(CountingResource* resource) {
+    std::lock_guard<std::mutex> lock(RegistryLock());
+    auto& resources = Registry();
+    resources.erase(std::remove(resources.begin(), resources.end(), resource), resources.end());
+}
+
+
+void MemoryResources::Report(tStatsHook hook) {
+    std::lock_guard<std::mutex> lock(RegistryLock());
+    for (CountingResource* resource : Registry())
+        hook(*resource);
+}
+
+
+std::string MemoryResources::ToText(void) {
+    std::string text;
+    Report([&text](const CountingResource& resource) {
+        const MemoryStats& stats = resource.m_stats;
+        char line[256];
+        snprintf(line, sizeof(line), "%s: %llu allocations, %llu frees, %llu bytes allocated, %llu in use, peak %llu\n", resource.m_name,
+                 (unsigned long long) stats.m_allocations.load(std::memory_order_relaxed), (unsigned long long) stats.m_deallocations.load(std::memory_order_relaxed),
+                 (unsigned long long) stats.m_bytesAllocated.load(std::memory_order_relaxed), (unsigned long long) stats.m_bytesInUse.load(std::memory_order_relaxed),
+                 (unsigned long long) stats.m_peakBytes.load(std::memory_order_relaxed));
+        text += line;
+    });
+    return text;
+}
+
+
+void MemoryResources::CountDefault(void) {
+    // never destroyed: containers may give memory back to it during static destruction
+    static CountingResource* defaultResource = new CountingResource("default", std::pmr::new_delete_resource());
+    std::pmr::set_default_resource(defaultResource);
+}
+
+// =================================================================================================
@@ -0,0 +1,74 @@
+#include <string.h>
+
+#include "messagecoalescer.h"
+
+// =================================================================================================
+
+bool MessageCoalescer::Queue(const UDPAddress& target, const char* message, size_t length) {
+    // the receiver would split the message at the separator
+    if (memchr(message, UDP_MESSAGE_SEPARATOR, length)) {
+        ++m_rejected;
+        return false;
+    }
+    size_t capacity = size_t(m_params.maxDatagramSize) - UDP_MESSAGE_PREFIX_LENGTH;
+    ++m_messages;
+    m_payloadBytes += length;
+    auto it = m_destinations.find(target.Key());
+    if (length >= capacity) { // doesn't fit together with anything else; goes after what is pending for target
+        if (it != m_destinations.end())
+            Close(m_pending[it->second]);
+        ++m_datagrams;
+        return m_udp.Queue(target, message, length);
+    }
+    if (it == m_destinations.end()) {
+        it = m_destinations.emplace(target.Key(), m_pending.size()).first;
+        m_pending.emplace_back();
+        m_pending.back().m_target = target;
+    }
+    Pending& pending = m_pending[it->second];
+    if ((pending.m_length > 0) and (pending.m_length + 1 + length > capacity))
+        Close(pending);
+    if (pending.m_length == 0)
+        pending.m_firstQueued = tClock::now();
+    else
+        pending.m_data[pending.m_length++] = UDP_MESSAGE_SEPARATOR;
+    memcpy(pending.m_data + pending.m_length, message, length);
+    pending.m_length += uint16_t(length);
+    return true;
+}
+
+
+bool MessageCoalescer::Close(Pending& pending) {
+    if (pending.m_length == 0)
+        return false;
+    ++m_datagrams;
+    bool queued = m_udp.Queue(pending.m_target, reinterpret_cast<const char*>(pending.m_data), pending.m_length);
+    pending.m_length = 0;
+    return queued;
+}
+
+
+int MessageCoalescer::Flush(void) {
+    int n = 0;
+    for (auto& pending : m_pending)
+        if (Close(pending))
+            ++n;
+    m_udp.Flush();
+    return n;
+}
+
+
+int MessageCoalescer::Update(void) {
+    if (m_params.maxDelay <= 0)
+        return 0;
+    tClock::time_point deadline = tClock::now() - std::chrono::milliseconds(m_params.maxDelay);
+    int n = 0;
+    for (auto& pending : m_pending)
+        if ((pending.m_length > 0) and (pending.m_firstQueued <= deadline) and Close(pending))
+            ++n;
+    if (n > 0)
+        m_udp.Flush();
+    return n;
+}
+
+// =================================================================================================
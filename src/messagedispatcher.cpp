@@ -0,0 +1,117 @@
+#include "messagedispatcher.h"
+
+// =================================================================================================
+// Empty slots have an empty keyword. Removal uses backward shift deletion, so lookups never need tombstones.
+
+size_t MessageDispatcher::Find(uint64_t hash, std::string_view keyword) const {
+    size_t mask = m_entries.size() - 1;
+    for (size_t i = size_t(hash) & mask; ; i = (i + 1) & mask) {
+        const Entry& entry = m_entries[i];
+        if (entry.m_keyword.empty() or ((entry.m_hash == hash) and (entry.m_keyword == keyword)))
+            return i;
+    }
+}
+
+
+void MessageDispatcher::Resize(size_t capacity) {
+    size_t size = 8;
+    while (size < capacity)
+        size <<= 1;
+    std::vector<Entry> entries(size);
+    entries.swap(m_entries);
+    for (Entry& entry : entries)
+        if (not entry.m_keyword.empty())
+            m_entries[Find(entry.m_hash, entry.m_keyword)] = std::move(entry);
+}
+
+
+void MessageDispatcher::Register(const MessageKeyword& keyword, int valueCount, tHandler handler) {
+    if (keyword.m_name.empty())
+        return;
+    if (m_dispatching > 0)
+        m_changes.push_back(Change{ keyword.m_hash, std::string(keyword.m_name), false, valueCount, std::move(handler) });
+    else
+        Insert(keyword.m_hash, keyword.m_name, valueCount, std::move(handler));
+}
+
+
+bool MessageDispatcher::Unregister(const MessageKeyword& keyword) {
+    if (m_dispatching == 0)
+        return Remove(keyword.m_hash, keyword.m_name);
+    m_changes.push_back(Change{ keyword.m_hash, std::string(keyword.m_name), true, 0, nullptr });
+    return not m_entries[Find(keyword.m_hash, keyword.m_name)].m_keyword.empty();
+}
+
+
+void MessageDispatcher::Insert(uint64_t hash, std::string_view keyword, int valueCount, tHandler handler) {
+    if (2 * (m_count + 1) > m_entries.size())
+        Resize(2 * m_entries.size());
+    Entry& entry = m_entries[Find(hash, keyword)];
+    if (entry.m_keyword.empty()) {
+        entry.m_hash = hash;
+        entry.m_keyword = keyword;
+        ++m_count;
+    }
+    entry.m_valueCount = valueCount;
+    entry.m_handler = std::move(handler);
+}
+
+
+bool MessageDispatcher::Remove(uint64_t hash, std::string_view keyword) {
+    size_t mask = m_entries.size() - 1;
+    size_t i = Find(hash, keyword);
+    if (m_entries[i].m_keyword.empty())
+        return false;
+    // move following entries of the probe chain up if the gap lies between their home slot and their slot
+    for (size_t j = (i + 1) & mask; not m_entries[j].m_keyword.empty(); j = (j + 1) & mask) {
+        size_t home = size_t(m_entries[j].m_hash) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            m_entries[i] = std::move(m_entries[j]);
+            i = j;
+        }
+    }
+    m_entries[i] = Entry();
+    --m_count;
+    return true;
+}
+
+
+MessageDispatcher::tResult MessageDispatcher::Dispatch(Message& message) {
+    std::string_view keyword = message.Keyword();
+    Entry& entry = m_entries[Find(KeywordHash(keyword), keyword)];
+    if (entry.m_keyword.empty()) {
+        ++m_unknown;
+        return tResult::Unknown;
+    }
+    if (not message.Validate(entry.m_valueCount)) {
+        ++m_malformed;
+        if (m_stats)
+            m_stats->m_invalidMessages.fetch_add(1, std::memory_order_relaxed);
+        return tResult::Malformed;
+    }
+    ++entry.m_dispatched;
+    ++m_dispatched;
+    DispatchScope scope(*this);
+    entry.m_handler(message);
+    return tResult::Handled;
+}
+
+
+MessageDispatcher::DispatchScope::~DispatchScope() {
+    if ((--m_dispatcher.m_dispatching == 0) and not m_dispatcher.m_changes.empty())
+        m_dispatcher.ApplyChanges();
+}
+
+
+// apply the changes handlers made during dispatch, in the order they were made
+void MessageDispatcher::ApplyChanges(void) {
+    std::vector<Change> changes;
+    changes.swap(m_changes);
+    for (Change& change : changes)
+        if (change.m_isRemoval)
+            Remove(change.m_hash, change.m_keyword);
+        else
+            Insert(change.m_hash, change.m_keyword, change.m_valueCount, std::move(change.m_handler));
+}
+
+// =================================================================================================
@@ -0,0 +1,59 @@
+#include <algorithm>
+
+#include "messagepool.h"
+
+// =================================================================================================
+
+void PooledMessage::Release(void) {
+    if (m_message) {
+        m_pool->Release(m_message);
+        m_message = nullptr;
+    }
+}
+
+// =================================================================================================
+
+MessagePool::MessagePool(size_t size, size_t maxSize)
+    : m_free(maxSize), m_blockSize(size ? size : 1), m_maxSize(maxSize), m_size(0), m_acquired(0), m_exhausted(0)
+{
+    Grow();
+}
+
+
+bool MessagePool::Grow(void) {
+    std::lock_guard<std::mutex> lock(m_growLock);
+    size_t size = m_size.load(std::memory_order_relaxed);
+    if (size >= m_maxSize)
+        return false;
+    size_t n = std::min(m_blockSize, m_maxSize - size);
+    m_blocks.push_back(std::make_unique<Entry[]>(n));
+    Entry* entries = m_blocks.back().get();
+    for (size_t i = 0; i < n; i++)
+        m_free.Push(&entries[i].m_message);
+    m_size.fetch_add(n, std::memory_order_relaxed);
+    return true;
+}
+
+
+PooledMessage MessagePool::Acquire(void) {
+    Message* message;
+    while (not m_free.Pop(message)) {
+        if (not Grow()) {
+            // another thread may have grown the pool or released a message in the meantime
+            if (m_free.Pop(message))
+                break;
+            m_exhausted.fetch_add(1, std::memory_order_relaxed);
+            return PooledMessage();
+        }
+    }
+    m_acquired.fetch_add(1, std::memory_order_relaxed);
+    return PooledMessage(message, this);
+}
+
+
+void MessagePool::Release(Message* message) {
+    message->Reset();
+    m_free.Push(message);
+}
+
+// =================================================================================================
@@ -0,0 +1,158 @@
+#include <string.h>
+
+#include "networkcapture.h"
+
+// =================================================================================================
+
+bool CaptureRecorder::Open(const char* fileName) {
+    Close();
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (not (m_file = fopen(fileName, "wb"))) {
+        fprintf(stderr, "CaptureRecorder: couldn't create '%s'\n", fileName);
+        return false;
+    }
+    setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+    uint8_t header[CAPTURE_HEADER_SIZE] = {};
+    memcpy(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    uint16_t version = CAPTURE_VERSION;
+    uint64_t startTime = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    memcpy(header + 6, &version, sizeof(version));
+    memcpy(header + 8, &startTime, sizeof(startTime));
+    fwrite(header, sizeof(header), 1, m_file);
+    m_start = tClock::now();
+    m_records = 0;
+    m_bytes = CAPTURE_HEADER_SIZE;
+    return true;
+}
+
+
+void CaptureRecorder::Close(void) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_file) {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+
+void CaptureRecorder::Record(bool sent, const UDPAddress& address, const char* prefix, size_t prefixLength, const char* data, size_t length) {
+    if (prefixLength + length > UDP_MAX_DATAGRAM_SIZE)
+        return;
+    // the file is only looked at under the lock Open and Close hold while they change it
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (not m_file)
+        return;
+    uint8_t record[CAPTURE_RECORD_SIZE];
+    uint64_t time = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(tClock::now() - m_start).count());
+    uint16_t l = uint16_t(prefixLength + length) | (sent ? CAPTURE_SENT_FLAG : 0);
+    memcpy(record, &time, sizeof(time));
+    memcpy(record + 8, &address.m_host, sizeof(address.m_host));
+    memcpy(record + 12, &address.m_port, sizeof(address.m_port));
+    memcpy(record + 14, &l, sizeof(l));
+    fwrite(record, sizeof(record), 1, m_file);
+    if (prefixLength)
+        fwrite(prefix, prefixLength, 1, m_file);
+    if (length)
+        fwrite(data, length, 1, m_file);
+    ++m_records;
+    m_bytes += sizeof(record) + prefixLength + length;
+}
+
+// =================================================================================================
+
+bool CaptureReplay::Open(const char* fileName, const ReplayParams& params) {
+    if (not m_map.OpenFile(fileName)) {
+        fprintf(stderr, "CaptureReplay: couldn't map '%s'\n", fileName);
+        return false;
+    }
+    const char* data = static_cast<const char*>(m_map.Data());
+    if ((m_map.Size() < CAPTURE_HEADER_SIZE) or memcmp(data, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC))) {
+        fprintf(stderr, "CaptureReplay: '%s' is no capture file\n", fileName);
+        m_map.Close();
+        return false;
+    }
+    m_params = params;
+    m_replayed = m_loops = 0;
+    Rewind();
+    return true;
+}
+
+
+void CaptureReplay::Close(void) {
+    m_map.Close();
+    m_offset = 0;
+}
+
+
+void CaptureReplay::Rewind(void) {
+    m_offset = CAPTURE_HEADER_SIZE;
+    m_start = tClock::now();
+    m_startTime = 0;
+    if (m_offset + CAPTURE_RECORD_SIZE <= m_map.Size())
+        memcpy(&m_startTime, static_cast<const uint8_t*>(m_map.Data()) + m_offset, sizeof(m_startTime));
+}
+
+
+uint64_t CaptureReplay::RecordingTime(void) const {
+    uint64_t time = 0;
+    if (m_map.Size() >= CAPTURE_HEADER_SIZE)
+        memcpy(&time, static_cast<const uint8_t*>(m_map.Data()) + 8, sizeof(time));
+    return time;
+}
+
+
+bool CaptureReplay::Next(UDPDatagram& datagram) {
+    if (not IsOpen())
+        return false;
+    const uint8_t* data = static_cast<const uint8_t*>(m_map.Data());
+    for (;;) {
+        if (m_offset + CAPTURE_RECORD_SIZE > m_map.Size()) {
+            if (not m_params.loop or (m_replayed == 0))
+                return false;
+            ++m_loops;
+            Rewind();
+            continue;
+        }
+        const uint8_t* record = data + m_offset;
+        uint64_t time;
+        uint16_t length;
+        memcpy(&time, record, sizeof(time));
+        memcpy(&length, record + 14, sizeof(length));
+        bool sent = (length & CAPTURE_SENT_FLAG) != 0;
+        length &= ~CAPTURE_SENT_FLAG;
+        if ((length > UDP_MAX_DATAGRAM_SIZE) or (m_offset + CAPTURE_RECORD_SIZE + length > m_map.Size())) {
+            m_offset = m_map.Size(); // truncated capture
+            continue;
+        }
+        if (m_params.speed > 0.0f) {
+            auto due = m_start + std::chrono::nanoseconds(int64_t(double(time - m_startTime) / m_params.speed));
+            if (tClock::now() < due)
+                return false;
+        }
+        m_offset += CAPTURE_RECORD_SIZE + length;
+        if (sent and not m_params.includeSent)
+            continue;
+        memcpy(&datagram.m_address.m_host, record + 8, sizeof(datagram.m_address.m_host));
+        memcpy(&datagram.m_address.m_port, record + 12, sizeof(datagram.m_address.m_port));
+        memcpy(datagram.m_data, record + CAPTURE_RECORD_SIZE, length);
+        datagram.m_length = length;
+        ++m_replayed;
+        return true;
+    }
+}
+
+
+int CaptureReplay::ReceiveBatch(UDPDatagramRing& ring) {
+    int n = 0;
+    while (not ring.IsFull()) {
+        uint32_t length;
+        UDPDatagram* slot = ring.FreeSpan(length);
+        if (not Next(*slot))
+            break;
+        ring.Commit(1);
+        ++n;
+    }
+    return n;
+}
+
+// =================================================================================================
@@ -1,8 +1,145 @@
+#include <string.h>
+
 #include "networkmessage.h"
 
 // =================================================================================================
 // network data and address
 
+Message& Message::Copy(const Message& other) {
+    if (this == &other)
+        return *this;
+    if (m_arena or other.m_arena) {
+        Assign(other.Payload(), other.PayloadLength(), other.Address(), other.m_port);
+        if (other.m_result != 0)
+            Parse();
+    }
+    else {
+        m_payload = other.m_payload;
+        m_address = other.m_address;
+        m_port = other.m_port;
+        m_numValues = other.m_numValues;
+        m_values = other.m_values;
+    }
+    m_result = other.m_result;
+    return *this;
+}
+
+
+Message& Message::Move(Message& other) {
+    if (this == &other)
+        return *this;
+    if (m_arena or other.m_arena)
+        return Copy(other);
+    m_payload = std::move(other.m_payload);
+    m_address = std::move(other.m_address);
+    m_port = other.m_port;
+    m_numValues = other.m_numValues;
+    m_values = std::move(other.m_values);
+    m_result = other.m_result;
+    return *this;
+}
+
+
+void Message::Assign(const char* payload, size_t length, const char* address, uint16_t port) {
+    if (m_arena) {
+        if (length > UDP_MAX_DATAGRAM_SIZE)
+            length = UDP_MAX_DATAGRAM_SIZE;
+        memcpy(m_arena->m_payload, payload, length);
+        m_arena->m_payload[length] = '\0';
+        m_arena->m_length = uint16_t(length);
+        strncpy(m_arena->m_address, address, sizeof(m_arena->m_address) - 1);
+        m_arena->m_address[sizeof(m_arena->m_address) - 1] = '\0';
+    }
+    else {
+        m_payload = String(payload, length);
+        m_address = String(address);
+        m_values.Reset();
+    }
+    m_port = port;
+    m_numValues = 0;
+    m_result = 0;
+}
+
+
+void Message::Reset(void) {
+    if (m_arena) {
+        m_arena->m_payload[0] = '\0';
+        m_arena->m_length = 0;
+        m_arena->m_address[0] = '\0';
+        m_arena->m_receiveTime = 0;
+    }
+    else {
+        m_payload = String("");
+        m_address = String("");
+        m_values.Reset();
+    }
+    m_port = 0;
+    m_numValues = 0;
+    m_result = 0;
+}
+
+
+std::string_view Message::Keyword(void) const {
+    std::string_view payload(Payload(), PayloadLength());
+    return payload.substr(0, payload.find('#'));
+}
+
+
+std::string_view Message::Value(int i) {
+    if ((i < 0) or (size_t(i) >= m_numValues))
+        return std::string_view();
+    if (m_arena)
+        return std::string_view(m_arena->m_payload + m_arena->m_valueOffsets[i], m_arena->m_valueLengths[i]);
+    return std::string_view(m_values[i].Data(), m_values[i].Length());
+}
+
+
+bool Message::Parse(void) {
+    if (m_arena)
+        return ParseArena();
+    m_values = m_payload.Split('#');
+    m_values = m_values[1].Split(';');
+    if (not m_values[0].IsEmpty())
+        m_numValues = m_values.Length();
+    else {
+        m_values.Reset();
+        m_numValues = 0;
+    }
+    return true;
+}
+
+
+// Same rules as the String based split, but only value positions are recorded. A message with
+// more than MESSAGE_MAX_VALUES values is rejected as a whole rather than truncated, so a value
+// count check can't accept it.
+bool Message::ParseArena(void) {
+    m_numValues = 0;
+    const char* payload = m_arena->m_payload;
+    const char* end = payload + m_arena->m_length;
+    const char* s = static_cast<const char*>(memchr(payload, '#', m_arena->m_length));
+    if (not s)
+        return true;
+    for (++s; ; s++) {
+        const char* e = static_cast<const char*>(memchr(s, ';', size_t(end - s)));
+        if (not e)
+            e = end;
+        if (m_numValues == MESSAGE_MAX_VALUES) {
+            m_numValues = 0;
+            return false;
+        }
+        m_arena->m_valueOffsets[m_numValues] = uint16_t(s - payload);
+        m_arena->m_valueLengths[m_numValues] = uint16_t(e - s);
+        ++m_numValues;
+        if (e == end)
+            break;
+        s = e;
+    }
+    if (m_arena->m_valueLengths[0] == 0)
+        m_numValues = 0;
+    return true;
+}
+
+
 bool Message::IsValid(int valueCount) {
     /*
         check a message for a match with the requested keyword
@@ -19,33 +156,28 @@ bool Message::IsValid(int valueCount) {
             < 0: specifies the required minimum number of parameters
             == 0: don't check parameter count
     */
-    m_values = m_payload.Split('#');
-    String keyword = m_values[0];
-    m_values = m_values[1].Split(';');
-    if (not m_values[0].IsEmpty())
-        m_numValues = m_values.Length();
-    else {
-        m_values.Reset();
-        m_numValues = 0;
-    }
-    if (valueCount == 0) {
+    if (Validate(valueCount))
+        return true;
+    std::string_view keyword = Keyword();
+    fprintf(stderr, "message %.*s has wrong number of values (expected %d, found %zd)", int(keyword.length()), keyword.data(), valueCount, m_numValues);
+    return false;
+}
+
+
+bool Message::Split(void) {
+    if (m_result == 0)
+        m_result = Parse() ? 2 : -2;
+    return m_result != -2;
+}
+
+
+bool Message::Validate(int valueCount) {
+    if (Split() and ((valueCount == 0) or ((valueCount > 0) and (m_numValues == size_t(valueCount))) or ((valueCount < 0) and (m_numValues >= size_t(-valueCount))))) {
         m_result = 1;
         return true;
     }
-    if (valueCount > 0) {
-        if (m_numValues == valueCount) {
-            m_result = 1;
-            return true;
-        }
-    }
-    else if (valueCount < 0) {
-        if (m_numValues >= -valueCount) {
-            m_result = 1;
-            return true;
-        }
-    }
-    fprintf(stderr, "message %s has wrong number of values (expected %d, found %zd)", static_cast<char*>(keyword), valueCount, m_numValues);
-    m_result = -1;
+    if (m_result != -2)
+        m_result = -1;
     return false;
 }
 
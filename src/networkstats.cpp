@@ -0,0 +1,152 @@
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "networkstats.h"
+
+// =================================================================================================
+
+static void Append(std::string& text, const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int l = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (l > 0)
+        text.append(buffer, size_t(l) < sizeof(buffer) ? size_t(l) : sizeof(buffer) - 1);
+}
+
+
+void TrafficCounters::Export(std::string& text, bool json) const {
+    Append(text, json ? "\"packetsIn\":%llu,\"bytesIn\":%llu,\"packetsOut\":%llu,\"bytesOut\":%llu,\"sendFailures\":%llu"
+                      : "in %llu packets / %llu bytes, out %llu packets / %llu bytes, %llu send failures",
+           (unsigned long long) m_packetsIn.load(std::memory_order_relaxed), (unsigned long long) m_bytesIn.load(std::memory_order_relaxed),
+           (unsigned long long) m_packetsOut.load(std::memory_order_relaxed), (unsigned long long) m_bytesOut.load(std::memory_order_relaxed),
+           (unsigned long long) m_sendFailures.load(std::memory_order_relaxed));
+}
+
+// =================================================================================================
+
+uint64_t LatencyHistogram::Percentile(double share) const {
+    uint64_t n = Count();
+    if (n == 0)
+        return 0;
+    uint64_t rank = uint64_t(share * double(n) + 0.5);
+    if (rank < 1)
+        rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < bucketCount; i++) {
+        seen += m_counts[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t low = LowerBound(i);
+            uint64_t high = (i + 1 < bucketCount) ? LowerBound(i + 1) : low + 1;
+            uint64_t value = (low + high - 1) / 2;
+            return (value < Max()) ? value : Max();
+        }
+    }
+    return Max();
+}
+
+
+void LatencyHistogram::Export(std::string& text, bool json) const {
+    Append(text, json ? "{\"count\":%llu,\"mean\":%.1f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}"
+                      : "n %llu, mean %.1f, p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, max %llu us",
+           (unsigned long long) Count(), Mean(), (unsigned long long) Percentile(0.5), (unsigned long long) Percentile(0.9),
+           (unsigned long long) Percentile(0.99), (unsigned long long) Percentile(0.999), (unsigned long long) Max());
+}
+
+// =================================================================================================
+
+// Insert-only open addressing: a slot is claimed by swapping its key from 0 to the peer's key.
+PeerStats& NetworkStats::Peer(const UDPAddress& address) {
+    uint64_t key = address.Key();
+    if (key == 0)
+        return m_otherPeers;
+    uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+    for (uint32_t n = 0, i = uint32_t(hash >> 32) & (maxPeers - 1); n < maxPeers; n++, i = (i + 1) & (maxPeers - 1)) {
+        uint64_t slotKey = m_peerKeys[i].load(std::memory_order_acquire);
+        if (slotKey == key)
+            return Slot(i, key);
+        if ((slotKey == 0) and (m_peerKeys[i].compare_exchange_strong(slotKey, key, std::memory_order_acq_rel) or (slotKey == key)))
+            return Slot(i, key);
+    }
+    return m_otherPeers;
+}
+
+
+// statistics of the peer owning slot i. Threads that find the slot empty at the same time each
+// create them; the first one to publish wins, the others delete theirs.
+PeerStats& NetworkStats::Slot(uint32_t i, uint64_t key) {
+    PeerStats* stats = m_peers[i].load(std::memory_order_acquire);
+    if (stats)
+        return *stats;
+    PeerStats* created = new PeerStats;
+    created->m_key.store(key, std::memory_order_relaxed);
+    if (m_peers[i].compare_exchange_strong(stats, created, std::memory_order_acq_rel))
+        return *created;
+    delete created;
+    return *stats;
+}
+
+
+std::string NetworkStats::Export(bool json) const {
+    std::string text;
+    text.reserve(4096);
+    const char* socketNames[2] = { "receive", "send" };
+    text += json ? "{\"sockets\":{" : "";
+    for (int i = 0; i < 2; i++) {
+        if (not m_sockets[i])
+            continue;
+        Append(text, json ? "%s\"%s\":{" : "%s%s socket: ", (json and (text.back() != '{')) ? "," : "", socketNames[i]);
+        m_sockets[i]->Export(text, json);
+        text += json ? "}" : "\n";
+    }
+    Append(text, json ? "},\"prefixMismatches\":%llu,\"invalidMessages\":%llu" : "prefix mismatches: %llu\ninvalid messages: %llu\n",
+           (unsigned long long) m_prefixMismatches.load(std::memory_order_relaxed), (unsigned long long) m_invalidMessages.load(std::memory_order_relaxed));
+    const Gauge* gauges[3] = { &m_sendQueue, &m_inQueue, &m_outQueue };
+    const char* gaugeNames[3] = { "send", "in", "out" };
+    text += json ? ",\"queues\":{" : "";
+    for (int i = 0; i < 3; i++)
+        Append(text, json ? "%s\"%s\":{\"depth\":%llu,\"max\":%llu}" : "%s%s queue: depth %llu, max %llu\n", (json and i) ? "," : "", gaugeNames[i],
+               (unsigned long long) gauges[i]->Value(), (unsigned long long) gauges[i]->Max());
+    text += json ? "},\"dispatchLatency\":" : "dispatch latency: ";
+    m_dispatchLatency.Export(text, json);
+    text += json ? ",\"rtt\":" : "\nrtt: ";
+    m_rtt.Export(text, json);
+    text += json ? ",\"peers\":[" : "\n";
+    bool first = true;
+    for (uint32_t i = 0; i <= maxPeers; i++) {
+        const PeerStats* stats = (i < maxPeers) ? m_peers[i].load(std::memory_order_acquire) : &m_otherPeers;
+        if (not stats)
+            continue;
+        const PeerStats& peer = *stats;
+        uint64_t key = peer.m_key.load(std::memory_order_relaxed);
+        if ((i == maxPeers) and (peer.m_packetsIn.load(std::memory_order_relaxed) + peer.m_packetsOut.load(std::memory_order_relaxed) == 0))
+            continue;
+        char host[16] = "other";
+        UDPAddress address(uint32_t(key >> 16), uint16_t(key));
+        if (i < maxPeers)
+            address.FormatHost(host);
+        Append(text, json ? "%s{\"address\":\"%s:%u\"," : "%speer %s:%u: ", (json and not first) ? "," : "", host, unsigned(address.Port()));
+        peer.Export(text, json);
+        if (peer.m_rtt.Count()) {
+            text += json ? ",\"rtt\":" : "; rtt ";
+            peer.m_rtt.Export(text, json);
+        }
+        text += json ? "}" : "\n";
+        first = false;
+    }
+    text += json ? "]}" : "";
+    return text;
+}
+
+
+std::string NetworkStats::ToText(void) const {
+    return Export(false);
+}
+
+
+std::string NetworkStats::ToJSON(void) const {
+    return Export(true);
+}
+
+// =================================================================================================
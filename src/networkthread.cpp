@@ -0,0 +1,145 @@
+#include <chrono>
+
+#include "networkthread.h"
+#include "tracing.h"
+
+// =================================================================================================
+
+NetworkThread::NetworkThread(UDP& udp, const NetworkThreadParams& params)
+    : m_udp(udp), m_params(params), m_pool(params.poolSize, params.inQueueSize + params.outQueueSize + params.ringSize), m_inQueue(params.inQueueSize), m_outQueue(params.outQueueSize), m_isRunning(false),
+      m_received(0), m_sent(0), m_droppedIn(0), m_droppedOut(0)
+{ }
+
+
+bool NetworkThread::Start(void) {
+    if (m_isRunning)
+        return true;
+    m_isRunning = true;
+    m_thread = std::thread(&NetworkThread::Run, this);
+    return true;
+}
+
+
+void NetworkThread::Stop(void) {
+    m_isRunning = false;
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+
+template <typename T, typename V>
+bool NetworkThread::Enqueue(LockFreeQueue<T>& queue, V&& item, BackpressurePolicy policy, std::atomic<uint64_t>& dropped, Gauge& depth) {
+    while (not queue.Push(std::forward<V>(item))) {
+        if (policy == BackpressurePolicy::DropNewest) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (policy == BackpressurePolicy::DropOldest) {
+            T oldest;
+            if (queue.Pop(oldest))
+                dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (not m_isRunning.load(std::memory_order_relaxed)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+            std::this_thread::yield();
+    }
+    depth.Set(queue.Length());
+    return true;
+}
+
+
+bool NetworkThread::Receive(PooledMessage& message) {
+    if (not m_inQueue.Pop(message))
+        return false;
+    uint64_t receiveTime = message->m_arena->m_receiveTime;
+    if (receiveTime)
+        m_udp.m_stats.m_dispatchLatency.Record(NetworkStats::Now() - receiveTime);
+    return true;
+}
+
+
+bool NetworkThread::Receive(Message& message) {
+    PooledMessage pooled;
+    if (not Receive(pooled))
+        return false;
+    message = *pooled;
+    return true;
+}
+
+
+bool NetworkThread::Transmit(const UDPPeer& peer, const String& message) {
+    if (not peer.IsValid())
+        return false;
+    OutgoingMessage outgoing;
+    outgoing.m_message = m_pool.Acquire();
+    if (not outgoing.m_message) {
+        m_droppedOut.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    outgoing.m_message->Assign(message.Data(), message.Length(), "", 0);
+    outgoing.m_target = peer.m_target;
+    return Enqueue(m_outQueue, std::move(outgoing), m_params.outPolicy, m_droppedOut, m_udp.m_stats.m_outQueue);
+}
+
+
+int NetworkThread::ProcessIncoming(UDPDatagramRing& ring) {
+    int n = m_udp.ReceiveBatch(ring);
+    if (n <= 0)
+        return 0;
+    m_received.fetch_add(uint64_t(n), std::memory_order_relaxed);
+    uint64_t receiveTime = NetworkStats::Now();
+    for (; not ring.IsEmpty(); ring.Pop()) {
+        uint16_t offset = 0;
+        for (;;) {
+            PooledMessage message = m_pool.Acquire();
+            if (not message) {
+                m_droppedIn.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            if (not UDP::NextMessage(ring.Front(), offset, *message))
+                break;
+            message->m_arena->m_receiveTime = receiveTime;
+            if (m_params.preParse)
+                message->Split();
+            Enqueue(m_inQueue, std::move(message), m_params.inPolicy, m_droppedIn, m_udp.m_stats.m_inQueue);
+        }
+    }
+    return n;
+}
+
+
+int NetworkThread::ProcessOutgoing(void) {
+    int n = 0;
+    OutgoingMessage outgoing;
+    while (m_outQueue.Pop(outgoing)) {
+        bool queued = m_udp.Queue(outgoing.m_target, outgoing.m_message->Payload(), outgoing.m_message->PayloadLength());
+        outgoing.m_message.Release();
+        if (queued)
+            ++n;
+        else
+            m_droppedOut.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (n > 0) {
+        m_udp.Flush();
+        m_sent.fetch_add(uint64_t(n), std::memory_order_relaxed);
+    }
+    return n;
+}
+
+
+void NetworkThread::Run(void) {
+    TRACE_THREAD_NAME("network");
+    UDPDatagramRing ring(m_params.ringSize);
+    while (m_isRunning.load(std::memory_order_relaxed)) {
+        int work = ProcessIncoming(ring);
+        work += ProcessOutgoing();
+        if ((work == 0) and (m_params.idleWait > 0))
+            std::this_thread::sleep_for(std::chrono::microseconds(m_params.idleWait));
+    }
+    ProcessOutgoing();
+}
+
+// =================================================================================================
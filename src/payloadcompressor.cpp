@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "udpdatagram.h"
+#include "payloadcompressor.h"
+
+// =================================================================================================
+
+// Fragments of the library's own protocol messages and of common values. Applications with their
+// own message set get much better results with a dictionary trained on their traffic (Train).
+static const char defaultDictionary[] =
+    "true;false;none;-1;0.0;0.5;1.0;0.000;1.000;-1.000;0.000000;"
+    "@dack#@rack#@rel#;0;0;0;0;1;1;1;1;10;100;1000;";
+
+
+PayloadCompressor::PayloadCompressor()
+    : m_dictionaryLength(0), m_dictionaryId(0), m_isEnabled(false), m_minLength(64),
+      m_compressed(0), m_skipped(0), m_rawBytes(0), m_compressedBytes(0), m_expanded(0), m_failures(0)
+{
+    SetDictionary(defaultDictionary, sizeof(defaultDictionary) - 1);
+}
+
+
+void PayloadCompressor::SetDictionary(const char* data, size_t length) {
+    if (length > COMPRESSION_DICTIONARY_SIZE) {
+        data += length - COMPRESSION_DICTIONARY_SIZE;
+        length = COMPRESSION_DICTIONARY_SIZE;
+    }
+    memcpy(m_dictionary, data, length);
+    m_dictionaryLength = uint16_t(length);
+    memset(m_dictionaryTable, 0, sizeof(m_dictionaryTable));
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < length; i++)
+        hash = (hash ^ m_dictionary[i]) * 16777619u;
+    m_dictionaryId = (length == 0) ? 0 : std::max<uint8_t>(1, uint8_t(hash ^ (hash >> 8) ^ (hash >> 16) ^ (hash >> 24)));
+    for (size_t i = 0; i + COMPRESSION_MIN_MATCH <= length; i++)
+        m_dictionaryTable[Hash(m_dictionary + i)] = uint16_t(i + 1);
+}
+
+
+// Messages are cut into keyword and value fragments (each with the separator that ends it). The
+// fragments saving the most bytes over all samples go into the dictionary, the best ones last,
+// where they don't get overwritten in the hash table by less useful ones.
+void PayloadCompressor::Train(const std::vector<std::string>& samples) {
+    std::unordered_map<std::string, uint32_t> counts;
+    for (const std::string& sample : samples) {
+        size_t start = 0;
+        for (size_t i = 0; i < sample.length(); i++) {
+            char c = sample[i];
+            if ((c == '#') or (c == ';') or (c == '\n') or (i + 1 == sample.length())) {
+                if (i + 1 - start >= 2)
+                    ++counts[sample.substr(start, i + 1 - start)];
+                start = i + 1;
+            }
+        }
+    }
+    std::vector<std::pair<uint64_t, const std::string*>> ranked;
+    for (const auto& [fragment, count] : counts)
+        if (count > 1)
+            ranked.emplace_back(uint64_t(count) * fragment.length(), &fragment);
+    std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return (a.first != b.first) ? a.first > b.first : *a.second < *b.second; });
+    std::vector<const std::string*> chosen;
+    size_t length = 0;
+    for (const auto& candidate : ranked) {
+        if (length + candidate.second->length() > COMPRESSION_DICTIONARY_SIZE)
+            continue;
+        chosen.push_back(candidate.second);
+        length += candidate.second->length();
+    }
+    std::string dictionary;
+    dictionary.reserve(length);
+    for (auto it = chosen.rbegin(); it != chosen.rend(); ++it)
+        dictionary += **it;
+    SetDictionary(dictionary.data(), dictionary.length());
+}
+
+// =================================================================================================
+
+static inline void PutLength(uint8_t*& op, size_t length) {
+    for (; length >= 255; length -= 255)
+        *op++ = 255;
+    *op++ = uint8_t(length);
+}
+
+
+// worst case size of a sequence, checked before writing it
+static inline size_t SequenceSize(size_t literals, size_t matchLength) {
+    return 1 + literals / 255 + 1 + literals + 2 + matchLength / 255 + 1;
+}
+
+
+// Greedy parse with a single entry hash table, like LZ4's fast mode. The window is the dictionary
+// followed by the data, so matches can start in the dictionary.
+size_t PayloadCompressor::Compress(const uint8_t* data, size_t length, uint8_t* output, size_t capacity) {
+    if ((length < size_t(COMPRESSION_MIN_MATCH)) or (length > UDP_MAX_DATAGRAM_SIZE) or (capacity <= COMPRESSION_HEADER_SIZE)) {
+        ++m_skipped;
+        return 0;
+    }
+    uint8_t window[COMPRESSION_DICTIONARY_SIZE + UDP_MAX_DATAGRAM_SIZE];
+    uint16_t table[1 << COMPRESSION_HASH_BITS];
+    memcpy(window, m_dictionary, m_dictionaryLength);
+    memcpy(window + m_dictionaryLength, data, length);
+    memcpy(table, m_dictionaryTable, sizeof(table));
+
+    uint8_t* op = output;
+    uint8_t* outputEnd = output + capacity;
+    *op++ = m_dictionaryId;
+    *op++ = uint8_t(length);
+    *op++ = uint8_t(length >> 8);
+    size_t anchor = m_dictionaryLength;
+    size_t end = m_dictionaryLength + length;
+    // after every 32 misses in a row the search steps one byte further (incompressible stretches are skipped faster)
+    size_t misses = 0;
+    for (size_t ip = anchor; ip + COMPRESSION_MIN_MATCH <= end; ) {
+        uint32_t h = Hash(window + ip);
+        size_t candidate = table[h];
+        table[h] = uint16_t(ip + 1);
+        if ((candidate == 0) or (memcmp(window + candidate - 1, window + ip, COMPRESSION_MIN_MATCH) != 0)) {
+            ip += 1 + (misses++ >> 5);
+            continue;
+        }
+        misses = 0;
+        size_t match = candidate - 1;
+        while ((ip > anchor) and (match > 0) and (window[ip - 1] == window[match - 1])) {
+            --ip;
+            --match;
+        }
+        size_t matchLength = COMPRESSION_MIN_MATCH;
+        while ((ip + matchLength < end) and (window[match + matchLength] == window[ip + matchLength]))
+            ++matchLength;
+        size_t literals = ip - anchor;
+        if (op + SequenceSize(literals, matchLength) > outputEnd) {
+            ++m_skipped;
+            return 0;
+        }
+        *op++ = uint8_t((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(matchLength - COMPRESSION_MIN_MATCH, 15));
+        if (literals >= 15)
+            PutLength(op, literals - 15);
+        memcpy(op, window + anchor, literals);
+        op += literals;
+        size_t offset = ip - match;
+        *op++ = uint8_t(offset);
+        *op++ = uint8_t(offset >> 8);
+        if (matchLength - COMPRESSION_MIN_MATCH >= 15)
+            PutLength(op, matchLength - COMPRESSION_MIN_MATCH - 15);
+        ip += matchLength;
+        anchor = ip;
+        // index a position inside the match, so repeated runs are found again
+        if (ip + 2 <= end)
+            table[Hash(window + ip - 2)] = uint16_t(ip - 2 + 1);
+    }
+    size_t literals = end - anchor;
+    if (op + SequenceSize(literals, 0) - 2 > outputEnd) {
+        ++m_skipped;
+        return 0;
+    }
+    *op++ = uint8_t(std::min<size_t>(literals, 15) << 4);
+    if (literals >= 15)
+        PutLength(op, literals - 15);
+    memcpy(op, window + anchor, literals);
+    op += literals;
+    ++m_compressed;
+    m_rawBytes += length;
+    m_compressedBytes += size_t(op - output);
+    return size_t(op - output);
+}
+
+// =================================================================================================
+
+static inline bool GetLength(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+    for (;;) {
+        if (ip >= end)
+            return false;
+        uint8_t b = *ip++;
+        length += b;
+        if (b < 255)
+            return true;
+    }
+}
+
+
+// Everything read from the payload is checked against the buffer bounds: it comes from the network.
+int PayloadCompressor::Expand(const uint8_t* data, size_t length, uint8_t* output, size_t capacity) {
+    if ((length < COMPRESSION_HEADER_SIZE + 1) or (data[0] != m_dictionaryId)) {
+        ++m_failures;
+        return -1;
+    }
+    size_t rawLength = size_t(data[1]) | (size_t(data[2]) << 8);
+    if ((rawLength > capacity) or (rawLength > UDP_MAX_DATAGRAM_SIZE)) {
+        ++m_failures;
+        return -1;
+    }
+    uint8_t window[COMPRESSION_DICTIONARY_SIZE + UDP_MAX_DATAGRAM_SIZE];
+    memcpy(window, m_dictionary, m_dictionaryLength);
+    size_t op = m_dictionaryLength;
+    size_t end = op + rawLength;
+    const uint8_t* ip = data + COMPRESSION_HEADER_SIZE;
+    const uint8_t* inputEnd = data + length;
+    for (;;) {
+        if (ip >= inputEnd)
+            break;
+        uint8_t token = *ip++;
+        size_t literals = token >> 4;
+        if ((literals == 15) and not GetLength(ip, inputEnd, literals))
+            break;
+        if ((literals > size_t(inputEnd - ip)) or (literals > end - op))
+            break;
+        memcpy(window + op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == inputEnd) {
+            if (op != end)
+                break;
+            memcpy(output, window + m_dictionaryLength, rawLength);
+            ++m_expanded;
+            return int(rawLength);
+        }
+        if (inputEnd - ip < 2)
+            break;
+        size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+        ip += 2;
+        size_t matchLength = token & 15;
+        if ((matchLength == 15) and not GetLength(ip, inputEnd, matchLength))
+            break;
+        matchLength += COMPRESSION_MIN_MATCH;
+        if ((offset == 0) or (offset > op) or (matchLength > end - op))
+            break;
+        // byte by byte: source and destination overlap for runs (offset < length)
+        for (size_t i = 0; i < matchLength; i++, op++)
+            window[op] = window[op - offset];
+    }
+    ++m_failures;
+    return -1;
+}
+
+// =================================================================================================
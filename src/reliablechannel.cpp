@@ -0,0 +1,240 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string_view>
+#include <algorithm>
+
+#include "reliablechannel.h"
+
+// =================================================================================================
+
+ReliableChannel::PeerState& ReliableChannel::Peer(uint64_t key) {
+    return m_peers.try_emplace(key, m_params.initialRTO, m_resource).first->second;
+}
+
+
+bool ReliableChannel::TransmitReliable(const UDPPeer& peer, const String& message, bool ordered) {
+    if (not peer.IsValid() or (message.Length() > maxMessageLength))
+        return false;
+    PeerState& state = Peer(peer.m_target.Key());
+    if (not state.m_replyPeer.IsValid())
+        state.m_replyPeer = peer;
+    if (state.m_unacked.size() >= m_params.windowSize)
+        return false;
+    Outgoing& outgoing = state.m_unacked.emplace_back(m_resource);
+    outgoing.m_sequence = state.m_nextSequence++;
+    if (outgoing.m_sequence == 0) // 0 means "nothing received"
+        outgoing.m_sequence = state.m_nextSequence++;
+    outgoing.m_ordered = ordered;
+    outgoing.m_fastResent = false;
+    outgoing.m_transmissions = 0;
+    outgoing.m_data.assign(message.Data(), message.Length());
+    ++state.m_sent;
+    Send(state, outgoing);
+    return true;
+}
+
+
+// (re)send message with the current ack state of peer piggybacked
+bool ReliableChannel::Send(PeerState& peer, Outgoing& message) {
+    char header[64];
+    int l = snprintf(header, sizeof(header), "@rel#%u:%c:%x:%x:%x;", unsigned(m_udp.InPort()), message.m_ordered ? 'o' : 'u',
+                     message.m_sequence, peer.m_lastReceived, AckBits(peer));
+    std::pmr::string datagram(m_resource);
+    datagram.reserve(size_t(l) + message.m_data.length());
+    (datagram = header) += message.m_data;
+    peer.m_ackPending = false;
+    message.m_lastSent = tClock::now();
+    ++message.m_transmissions;
+    return m_udp.Transmit(peer.m_replyPeer, datagram.data(), datagram.length());
+}
+
+
+uint32_t ReliableChannel::AckBits(const PeerState& peer) const {
+    uint32_t bits = 0;
+    if (peer.m_lastReceived != 0)
+        for (uint32_t i = 0; i < 32; i++)
+            if (peer.HasReceived(peer.m_lastReceived - 1 - i))
+                bits |= uint32_t(1) << i;
+    return bits;
+}
+
+
+void ReliableChannel::Acknowledge(PeerState& peer, uint32_t ack, uint32_t bits) {
+    if (ack == 0)
+        return;
+    tClock::time_point now = tClock::now();
+    for (auto it = peer.m_unacked.begin(); it != peer.m_unacked.end(); ) {
+        int32_t d = int32_t(ack - it->m_sequence);
+        if (d < 0)
+            break;
+        if ((d == 0) or ((d <= 32) and (bits & (uint32_t(1) << (d - 1))))) {
+            if (it->m_transmissions == 1) // Karn: resent messages give ambiguous samples
+                UpdateRTT(peer, std::chrono::duration<float, std::milli>(now - it->m_lastSent).count());
+            ++peer.m_acked;
+            it = peer.m_unacked.erase(it);
+        }
+        else {
+            // the peer already has a message three or more sequences newer: this one is most likely lost
+            if ((d >= 3) and not it->m_fastResent) {
+                it->m_fastResent = true;
+                ++peer.m_resent;
+                Send(peer, *it);
+            }
+            ++it;
+        }
+    }
+}
+
+
+void ReliableChannel::UpdateRTT(PeerState& peer, float rtt) {
+    if (peer.m_srtt == 0.0f) {
+        peer.m_srtt = rtt;
+        peer.m_rttVar = rtt / 2.0f;
+    }
+    else {
+        peer.m_rttVar = 0.75f * peer.m_rttVar + 0.25f * fabsf(peer.m_srtt - rtt);
+        peer.m_srtt = 0.875f * peer.m_srtt + 0.125f * rtt;
+    }
+    m_udp.m_stats.m_rtt.Record(uint64_t(rtt * 1000.0f));
+    if (peer.m_replyPeer.IsValid())
+        m_udp.m_stats.Peer(peer.m_replyPeer.m_target).m_rtt.Record(uint64_t(rtt * 1000.0f));
+    peer.m_rto = std::clamp(int(peer.m_srtt + std::max(4.0f * peer.m_rttVar, 1.0f) + 0.5f), m_params.minRTO, m_params.maxRTO);
+}
+
+
+void ReliableChannel::Received(PeerState& peer, uint32_t sequence) {
+    if ((peer.m_lastReceived == 0) or (int32_t(sequence - peer.m_lastReceived) > 0))
+        peer.m_lastReceived = sequence;
+    if (sequence != peer.m_nextExpected)
+        peer.m_receivedAhead.insert(sequence);
+    else {
+        ++peer.m_nextExpected;
+        for (auto it = peer.m_receivedAhead.begin(); (it != peer.m_receivedAhead.end()) and (*it == peer.m_nextExpected); it = peer.m_receivedAhead.erase(it))
+            ++peer.m_nextExpected;
+    }
+    peer.m_ackPending = true;
+}
+
+
+ReliableChannel::tResult ReliableChannel::Decode(Message& message) {
+    std::string_view keyword = message.Keyword();
+    bool isData = (keyword == "@rel");
+    if (not isData and (keyword != "@rack"))
+        return tResult::Passed;
+    UDPAddress sender;
+    if (not sender.ParseHost(message.Address()))
+        return tResult::Passed;
+    const char* text = message.Payload();
+    size_t length = message.PayloadLength();
+    char* s = const_cast<char*>(text) + keyword.length() + 1;
+    uint16_t port = uint16_t(strtoul(s, &s, 10));
+    sender.SetPort(port);
+    PeerState& peer = Peer(sender.Key());
+    if (not peer.m_replyPeer.IsValid()) {
+        char host[16];
+        sender.FormatHost(host);
+        peer.m_replyPeer.Resolve(String(host), port);
+    }
+
+    if (not isData) {
+        uint32_t ack = uint32_t(strtoul(s + 1, &s, 16));
+        uint32_t bits = uint32_t(strtoul(s + 1, &s, 16));
+        Acknowledge(peer, ack, bits);
+        return tResult::Consumed;
+    }
+
+    bool ordered = (s[1] == 'o');
+    s += 2;
+    uint32_t sequence = uint32_t(strtoul(s + 1, &s, 16));
+    uint32_t ack = uint32_t(strtoul(s + 1, &s, 16));
+    uint32_t bits = uint32_t(strtoul(s + 1, &s, 16));
+    if ((*s != ';') or (sequence == 0))
+        return tResult::Consumed;
+    Acknowledge(peer, ack, bits);
+    if (peer.HasReceived(sequence)) { // our ack got lost; ack again
+        ++peer.m_duplicates;
+        peer.m_ackPending = true;
+        return tResult::Consumed;
+    }
+    Received(peer, sequence);
+
+    const char* data = s + 1;
+    std::pmr::string payload(data, size_t(text + length - data), m_resource);
+    if (ordered and (int32_t(sequence - peer.m_nextExpected) >= 0)) {
+        peer.m_heldBack.emplace(sequence, std::move(payload));
+        return tResult::Consumed;
+    }
+    // everything held back up to the first gap can go now, after this message
+    for (auto it = peer.m_heldBack.begin(); (it != peer.m_heldBack.end()) and (int32_t(it->first - peer.m_nextExpected) < 0); it = peer.m_heldBack.erase(it)) {
+        Delivery& delivery = m_ready.emplace_back(m_resource);
+        delivery.m_data = std::move(it->second);
+        strncpy(delivery.m_address, message.Address(), sizeof(delivery.m_address) - 1);
+        delivery.m_address[sizeof(delivery.m_address) - 1] = '\0';
+        delivery.m_port = message.m_port;
+    }
+    char address[16];
+    strncpy(address, message.Address(), sizeof(address) - 1);
+    address[sizeof(address) - 1] = '\0';
+    message.Assign(payload.data(), payload.length(), address, message.m_port);
+    return tResult::Delivered;
+}
+
+
+bool ReliableChannel::Receive(Message& message) {
+    for (;;) {
+        if (not m_ready.empty()) {
+            Delivery& delivery = m_ready.front();
+            message.Assign(delivery.m_data.data(), delivery.m_data.length(), delivery.m_address, delivery.m_port);
+            m_ready.pop_front();
+            return true;
+        }
+        message = m_udp.Receive();
+        if (message.IsEmpty())
+            return false;
+        if (Decode(message) != tResult::Consumed)
+            return true;
+    }
+}
+
+
+int ReliableChannel::Update(void) {
+    tClock::time_point now = tClock::now();
+    int n = 0;
+    for (auto& [key, peer] : m_peers) {
+        bool timedOut = false;
+        for (auto& outgoing : peer.m_unacked)
+            if (now - outgoing.m_lastSent >= std::chrono::milliseconds(peer.m_rto)) {
+                timedOut = true;
+                ++peer.m_resent;
+                ++n;
+                Send(peer, outgoing);
+            }
+        if (timedOut) // back off until a clean RTT sample arrives
+            peer.m_rto = std::min(peer.m_rto * 2, m_params.maxRTO);
+        if (peer.m_ackPending and peer.m_replyPeer.IsValid()) {
+            char ack[64];
+            int l = snprintf(ack, sizeof(ack), "@rack#%u:%x:%x", unsigned(m_udp.InPort()), peer.m_lastReceived, AckBits(peer));
+            m_udp.Queue(peer.m_replyPeer.m_target, ack, size_t(l));
+            peer.m_ackPending = false;
+            ++n;
+        }
+    }
+    m_udp.Flush();
+    return n;
+}
+
+
+float ReliableChannel::RoundTripTime(const UDPPeer& peer) {
+    auto it = m_peers.find(peer.m_target.Key());
+    return (it == m_peers.end()) ? 0.0f : it->second.m_srtt;
+}
+
+
+uint32_t ReliableChannel::Unacknowledged(const UDPPeer& peer) {
+    auto it = m_peers.find(peer.m_target.Key());
+    return (it == m_peers.end()) ? 0 : uint32_t(it->second.m_unacked.size());
+}
+
+// =================================================================================================
@@ -0,0 +1,166 @@
+#include <math.h>
+#include <string_view>
+#include <algorithm>
+
+#include "messagecoalescer.h"
+#include "sendscheduler.h"
+
+// =================================================================================================
+
+void SendScheduler::ClassQueue::PopFront(void) {
+    Pending& front = m_messages.front();
+    if (not front.m_key.empty()) {
+        auto it = m_keys.find(front.m_key);
+        if ((it != m_keys.end()) and (it->second == m_firstSequence))
+            m_keys.erase(it);
+    }
+    m_messages.pop_front();
+    ++m_firstSequence;
+}
+
+// =================================================================================================
+
+bool SendScheduler::Queue(const UDPPeer& peer, const String& message, SendPriority priority, bool merge) {
+    if (not peer.IsValid())
+        return false;
+    tClock::time_point now = tClock::now();
+    auto [index, isNew] = m_peerIndex.try_emplace(peer.m_target.Key(), m_peers.size());
+    if (isNew) {
+        PeerQueue& p = m_peers.emplace_back(m_resource);
+        p.m_peer = peer;
+        p.m_tokens = double(m_params.burstBytes);
+        p.m_lastRefill = now;
+    }
+    PeerQueue& p = m_peers[index->second];
+    ClassQueue& queue = p.m_classes[int(priority)];
+    ClassStats& stats = m_stats[int(priority)];
+    ++stats.m_queued;
+
+    std::pmr::string key(m_resource);
+    if (merge) {
+        std::string_view text(message.Data(), message.Length());
+        size_t hash = text.find('#');
+        key = text.substr(0, (hash == std::string_view::npos) ? hash : text.find(';', hash + 1));
+        auto k = queue.m_keys.find(key);
+        if ((k != queue.m_keys.end()) and (k->second >= queue.m_firstSequence)) {
+            Pending& pending = queue.m_messages[size_t(k->second - queue.m_firstSequence)];
+            pending.m_data.assign(message.Data(), message.Length());
+            pending.m_queued = now;
+            ++stats.m_merged;
+            return true;
+        }
+    }
+    if (queue.m_messages.size() >= m_params.maxQueued) {
+        queue.PopFront();
+        ++stats.m_dropped;
+        --stats.m_depth;
+    }
+    if (not key.empty())
+        queue.m_keys[key] = queue.m_firstSequence + queue.m_messages.size();
+    Pending& pending = queue.m_messages.emplace_back(m_resource);
+    pending.m_data.assign(message.Data(), message.Length());
+    pending.m_key = std::move(key);
+    pending.m_queued = now;
+    ++stats.m_depth;
+    return true;
+}
+
+
+void SendScheduler::Refill(PeerQueue& peer, tClock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - peer.m_lastRefill).count();
+    peer.m_tokens = std::min(double(m_params.burstBytes), peer.m_tokens + elapsed * double(m_params.bytesPerSecond));
+    peer.m_lastRefill = now;
+}
+
+
+void SendScheduler::DropExpired(PeerQueue& peer, tClock::time_point now) {
+    for (int c = 0; c < SEND_PRIORITY_CLASSES; c++) {
+        if (m_params.maxAge[c] <= 0)
+            continue;
+        tClock::time_point deadline = now - std::chrono::milliseconds(m_params.maxAge[c]);
+        ClassQueue& queue = peer.m_classes[c];
+        while (not queue.m_messages.empty() and (queue.m_messages.front().m_queued < deadline)) {
+            queue.PopFront();
+            ++m_stats[c].m_dropped;
+            --m_stats[c].m_depth;
+        }
+    }
+}
+
+
+// Peers take turns sending one message each, so a peer with a long queue can't delay the others.
+// A peer whose bucket can't pay for its most important message sends nothing else either, so less
+// important messages never overtake it.
+int SendScheduler::Send(bool paced) {
+    tClock::time_point now = tClock::now();
+    int64_t allowance = INT64_MAX; // paced messages that may still go out now
+    if (paced) {
+        auto interval = std::chrono::milliseconds(m_params.tickInterval);
+        if ((m_tickStart == tClock::time_point()) or (now - m_tickStart >= interval)) {
+            m_tickStart = now;
+            m_tickBacklog = 0;
+            for (int c = int(SendPriority::State); c < SEND_PRIORITY_CLASSES; c++)
+                m_tickBacklog += m_stats[c].m_depth;
+            m_tickSent = 0;
+        }
+        double share = (m_params.tickInterval > 0) ? std::chrono::duration<double>(now - m_tickStart) / interval : 1.0;
+        allowance = int64_t(ceil(double(m_tickBacklog) * std::min(share, 1.0))) - int64_t(m_tickSent);
+    }
+    for (PeerQueue& peer : m_peers) {
+        Refill(peer, now);
+        DropExpired(peer, now);
+    }
+    int n = 0;
+    size_t count = m_peers.size();
+    for (bool progress = true; progress; ) {
+        progress = false;
+        for (size_t i = 0; i < count; i++) {
+            PeerQueue& peer = m_peers[(m_nextPeer + i) % count];
+            for (int c = 0; c < SEND_PRIORITY_CLASSES; c++) {
+                ClassQueue& queue = peer.m_classes[c];
+                if (queue.m_messages.empty())
+                    continue;
+                bool isPaced = (c != int(SendPriority::Input));
+                if (isPaced and (allowance <= 0))
+                    break;
+                Pending& message = queue.m_messages.front();
+                double size = double(message.m_data.length() + UDP_MESSAGE_PREFIX_LENGTH + UDP_HEADER_OVERHEAD);
+                // a full bucket lets any message through (the tokens go negative), so messages
+                // larger than burstBytes don't block the queue forever
+                if ((peer.m_tokens < size) and (peer.m_tokens < double(m_params.burstBytes)))
+                    break;
+                if (m_udp.Queue(peer.m_peer.m_target, message.m_data.data(), message.m_data.length()))
+                    ++m_stats[c].m_sent;
+                else
+                    ++m_stats[c].m_dropped;
+                --m_stats[c].m_depth;
+                queue.PopFront();
+                peer.m_tokens -= size;
+                if (isPaced) {
+                    --allowance;
+                    ++m_tickSent;
+                }
+                ++n;
+                progress = true;
+                break;
+            }
+        }
+    }
+    if (count > 0)
+        m_nextPeer = (m_nextPeer + 1) % count;
+    if (n > 0)
+        m_udp.Flush();
+    return n;
+}
+
+
+int SendScheduler::Update(void) {
+    return Send(true);
+}
+
+
+int SendScheduler::Flush(void) {
+    return Send(false);
+}
+
+// =================================================================================================
@@ -0,0 +1,228 @@
+#include <errno.h>
+#include <stdio.h>
+#include <new>
+
+#include "sharedmemorytransport.h"
+
+#ifndef _WIN32
+#   include <signal.h>
+#   include <unistd.h>
+#endif
+
+// =================================================================================================
+
+static int32_t CurrentProcessId(void) {
+#ifdef _WIN32
+    return int32_t(GetCurrentProcessId());
+#else
+    return int32_t(getpid());
+#endif
+}
+
+
+// true for an inbox whose owner process is gone without closing it (crashed). Owners that are
+// alive (or whose process id has been reused) keep their inbox.
+static bool IsStale(const char* name) {
+#ifdef _WIN32
+    (void) name;
+    return false; // mappings disappear with their last handle
+#else
+    MemoryMap map;
+    if (not map.Open(name) or (map.Size() < sizeof(SharedMemoryTransport::RingHeader)))
+        return false;
+    int32_t owner = static_cast<const SharedMemoryTransport::RingHeader*>(map.Data())->m_owner;
+    return (owner > 0) and (kill(owner, 0) < 0) and (errno == ESRCH);
+#endif
+}
+
+
+// The inbox name only depends on the port, so it may be taken: by a live inbox of another process,
+// which is left alone, or by one a crashed process left behind, which is removed.
+bool SharedMemoryTransport::Ring::Create(const char* name, uint32_t capacity) {
+    uint32_t size = 2;
+    while (size < capacity)
+        size <<= 1;
+    size_t bytes = sizeof(RingHeader) + size_t(size) * sizeof(Cell);
+    if (not m_map.Create(name, bytes) and not (IsStale(name) and MemoryMap::Remove(name) and m_map.Create(name, bytes)))
+        return false;
+    m_header = new (m_map.Data()) RingHeader;
+    m_cells = reinterpret_cast<Cell*>(m_header + 1);
+    for (uint32_t i = 0; i < size; i++)
+        new (&m_cells[i].m_sequence) std::atomic<uint64_t>(i);
+    m_header->m_capacity = size;
+    m_header->m_owner = CurrentProcessId();
+    m_header->m_closed.store(0, std::memory_order_relaxed);
+    m_header->m_pushPos.store(0, std::memory_order_relaxed);
+    m_header->m_popPos.store(0, std::memory_order_relaxed);
+    m_header->m_magic.store(SHARED_MEMORY_MAGIC, std::memory_order_release);
+    m_mask = size - 1;
+    return true;
+}
+
+
+bool SharedMemoryTransport::Ring::Open(const char* name) {
+    if (not m_map.Open(name))
+        return false;
+    RingHeader* header = reinterpret_cast<RingHeader*>(m_map.Data());
+    if ((m_map.Size() < sizeof(RingHeader)) or (header->m_magic.load(std::memory_order_acquire) != SHARED_MEMORY_MAGIC) or header->m_closed.load(std::memory_order_relaxed) or
+        (m_map.Size() < sizeof(RingHeader) + size_t(header->m_capacity) * sizeof(Cell))) {
+        m_map.Close();
+        return false;
+    }
+    m_header = header;
+    m_cells = reinterpret_cast<Cell*>(m_header + 1);
+    m_mask = m_header->m_capacity - 1;
+    return true;
+}
+
+
+void SharedMemoryTransport::Ring::Close(void) {
+    if (m_header and m_map.m_isOwner)
+        m_header->m_closed.store(1, std::memory_order_release);
+    m_map.Close();
+    m_header = nullptr;
+    m_cells = nullptr;
+}
+
+
+bool SharedMemoryTransport::Ring::Push(const UDPAddress& source, const char* prefix, size_t prefixLength, const char* data, size_t length) {
+    Cell* cell;
+    uint64_t pos = m_header->m_pushPos.load(std::memory_order_relaxed);
+    for (;;) {
+        cell = &m_cells[pos & m_mask];
+        uint64_t sequence = cell->m_sequence.load(std::memory_order_acquire);
+        int64_t diff = int64_t(sequence) - int64_t(pos);
+        if (diff == 0) {
+            if (m_header->m_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return false; // full
+        else
+            pos = m_header->m_pushPos.load(std::memory_order_relaxed);
+    }
+    // the cell is ours now; if the datagram is too large it is published empty and skipped by Pop
+    if (not cell->m_datagram.Assign(source, prefix, prefixLength, data, length))
+        cell->m_datagram.m_length = 0;
+    cell->m_sequence.store(pos + 1, std::memory_order_release);
+    return cell->m_datagram.m_length > 0;
+}
+
+
+bool SharedMemoryTransport::Ring::Pop(UDPDatagram& datagram) {
+    for (;;) {
+        Cell* cell;
+        uint64_t pos = m_header->m_popPos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            uint64_t sequence = cell->m_sequence.load(std::memory_order_acquire);
+            int64_t diff = int64_t(sequence) - int64_t(pos + 1);
+            if (diff == 0) {
+                if (m_header->m_popPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false; // empty
+            else
+                pos = m_header->m_popPos.load(std::memory_order_relaxed);
+        }
+        // the cell is shared with other processes: a length beyond the slot size drops the cell instead of overrunning datagram
+        uint16_t length = cell->m_datagram.m_length;
+        datagram.m_address = cell->m_datagram.m_address;
+        datagram.m_length = (length <= UDP_MAX_DATAGRAM_SIZE) ? length : 0;
+        memcpy(datagram.m_data, cell->m_datagram.m_data, datagram.m_length);
+        cell->m_sequence.store(pos + m_mask + 1, std::memory_order_release);
+        if (datagram.m_length > 0)
+            return true;
+    }
+}
+
+// =================================================================================================
+
+void SharedMemoryTransport::InboxName(uint16_t port, char* name, size_t size) {
+    snprintf(name, size, "apptools_udp_%u", unsigned(port));
+}
+
+
+bool SharedMemoryTransport::Open(uint16_t receivePort, const UDPAddress& source, uint32_t capacity) {
+    char name[32];
+    InboxName(receivePort, name, sizeof(name));
+    m_source = source;
+    if (not m_inbox.Create(name, capacity)) {
+        fprintf(stderr, "SharedMemoryTransport: couldn't create inbox for port %u\n", unsigned(receivePort));
+        return false;
+    }
+    return true;
+}
+
+
+void SharedMemoryTransport::Close(void) {
+    m_inbox.Close();
+    m_outboxes.clear();
+}
+
+
+bool SharedMemoryTransport::IsLocal(const UDPAddress& target) const {
+    return (reinterpret_cast<const uint8_t*>(&target.m_host)[0] == 127) or (target.m_host == m_source.m_host);
+}
+
+
+// Inboxes that couldn't be opened are retried, and the owner of an open one is checked, once per second.
+SharedMemoryTransport::Ring* SharedMemoryTransport::Outbound(const UDPAddress& target) {
+    std::unique_ptr<Outbox>& outbox = m_outboxes[target.m_port];
+    if (not outbox)
+        outbox = std::make_unique<Outbox>();
+    tClock::time_point now = tClock::now();
+    bool check = (now - outbox->m_lastCheck >= std::chrono::seconds(1));
+    Ring& ring = outbox->m_ring;
+    if (ring.IsOpen()) {
+        bool gone = ring.m_header->m_closed.load(std::memory_order_relaxed);
+#ifndef _WIN32
+        if (check) {
+            outbox->m_lastCheck = now;
+            gone = gone or ((kill(ring.m_header->m_owner, 0) < 0) and (errno == ESRCH));
+        }
+#endif
+        if (not gone)
+            return &ring;
+        ring.Close();
+        check = true;
+    }
+    if (check) {
+        outbox->m_lastCheck = now;
+        char name[32];
+        InboxName(target.Port(), name, sizeof(name));
+        if (ring.Open(name))
+            return &ring;
+    }
+    return nullptr;
+}
+
+
+bool SharedMemoryTransport::Send(const UDPAddress& target, const char* prefix, size_t prefixLength, const char* data, size_t length) {
+    if (not (IsOpen() and IsLocal(target)))
+        return false;
+    Ring* ring = Outbound(target);
+    if (not (ring and ring->Push(m_source, prefix, prefixLength, data, length))) {
+        ++m_fallbacks;
+        return false;
+    }
+    ++m_sent;
+    return true;
+}
+
+
+int SharedMemoryTransport::ReceiveBatch(UDPDatagramRing& ring) {
+    int n = 0;
+    while (not ring.IsFull()) {
+        uint32_t length;
+        UDPDatagram* slot = ring.FreeSpan(length);
+        if (not Receive(*slot))
+            break;
+        ring.Commit(1);
+        ++n;
+    }
+    return n;
+}
+
+// =================================================================================================
@@ -1,34 +1,42 @@
 #define NOMINMAX
 
 #include "textfileloader.h"
+#include "jobsystem.h"
+#include "tracing.h"
 
+#include <string.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <algorithm>
+#include <charconv>
+#include <vector>
 
 // =================================================================================================
 
-TableDimensions TextFileLoader::ReadLines(const char * fileName, List<String>& textLines, tLineFilter filter) {
+TableDimensions TextFileLoader::ReadLines(const char * fileName, List<String>& textLines, tLineFilter filter, std::pmr::memory_resource* resource) {
+    TRACE_ZONE("TextFileLoader::ReadLines");
     std::ifstream stream(fileName);
     if (not stream.is_open())
         return TableDimensions(0,0);
-    return ReadStream(stream, textLines, filter);
+    return ReadStream(stream, textLines, filter, resource);
 }
 
 
-TableDimensions TextFileLoader::CopyLines(const String& lineBuffer, List<String>& textLines, tLineFilter filter) {
+TableDimensions TextFileLoader::CopyLines(const String& lineBuffer, List<String>& textLines, tLineFilter filter, std::pmr::memory_resource* resource) {
+    TRACE_ZONE("TextFileLoader::CopyLines");
     std::istringstream stream(lineBuffer);
-    return ReadStream(stream, textLines, filter);
+    return ReadStream(stream, textLines, filter, resource);
 }
 
 
-TableDimensions TextFileLoader::ReadStream(std::istream& stream, List<String>& textLines, tLineFilter filter) {
-    std::string line;
+TableDimensions TextFileLoader::ReadStream(std::istream& stream, List<String>& textLines, tLineFilter filter, std::pmr::memory_resource* resource) {
+    std::pmr::string line(resource ? resource : std::pmr::get_default_resource());
     int rows = 0;
     int cols = 0;
     while (std::getline(stream, line)) {
-        String s(line);
+        String s(line.data(), line.length());
         if (filter(s)) {
             rows++;
             cols = std::max(cols, int(line.length()));
@@ -38,4 +46,189 @@ TableDimensions TextFileLoader::ReadStream(std::istream& stream, List<String>& t
     return TableDimensions(cols, rows);
 }
 
+
+TableDimensions TextFileLoader::ParseLines(const char* data, size_t length, List<String>& textLines, tLineFilter filter) {
+    int rows = 0;
+    int cols = 0;
+    const char* end = data + length;
+    for (const char* s = data; s < end; ) {
+        const char* e = static_cast<const char*>(memchr(s, '\n', size_t(end - s)));
+        if (not e)
+            e = end;
+        size_t l = size_t(e - s);
+        if ((l > 0) and (s[l - 1] == '\r'))
+            --l;
+        String line(s, l);
+        if (filter(line)) {
+            rows++;
+            cols = std::max(cols, int(l));
+            textLines.Append(std::move(line));
+        }
+        s = e + 1;
+    }
+    return TableDimensions(cols, rows);
+}
+
+
+// read the whole file into data
+static bool ReadFile(const char* fileName, std::pmr::string& data) {
+    std::ifstream stream(fileName);
+    if (not stream.is_open())
+        return false;
+    // in text mode fewer characters than the file size may arrive (CR LF -> LF)
+    stream.seekg(0, std::ios::end);
+    data.assign(size_t(std::max<std::streamoff>(0, stream.tellg())), '\0');
+    stream.seekg(0, std::ios::beg);
+    stream.read(data.data(), std::streamsize(data.length()));
+    data.resize(size_t(stream.gcount()));
+    return true;
+}
+
+
+// Chunks end after a line break, so no line is split between two of them. Each chunk collects its
+// lines separately; they are appended to textLines in file order at the end.
+TableDimensions TextFileLoader::ReadLinesParallel(const char* fileName, List<String>& textLines, tLineFilter filter, size_t chunkSize,
+                                                  std::pmr::memory_resource* resource) {
+    TRACE_ZONE("TextFileLoader::ReadLinesParallel");
+    if (not resource)
+        resource = std::pmr::get_default_resource();
+    std::pmr::string data(resource);
+    if (not ReadFile(fileName, data))
+        return TableDimensions(0,0);
+
+    std::pmr::vector<size_t> starts(resource);
+    for (size_t start = 0; start < data.length(); ) {
+        starts.push_back(start);
+        size_t end = data.find('\n', std::min(start + std::max<size_t>(chunkSize, 1), data.length()) - 1);
+        start = (end == std::pmr::string::npos) ? data.length() : end + 1;
+    }
+    starts.push_back(data.length());
+
+    class Chunk {
+        public:
+            std::vector<String> m_lines;
+            int                 m_cols = 0;
+    };
+    std::pmr::vector<Chunk> chunks(starts.size() - 1, resource);
+    jobSystem.ParallelFor(0, chunks.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            TRACE_ZONE("TextFileLoader::ParseChunk");
+            Chunk& chunk = chunks[i];
+            chunk.m_lines.reserve(size_t(std::count(data.begin() + starts[i], data.begin() + starts[i + 1], '\n')) + 1);
+            for (size_t start = starts[i]; start < starts[i + 1]; ) {
+                size_t end = data.find('\n', start);
+                if ((end == std::string::npos) or (end > starts[i + 1]))
+                    end = starts[i + 1];
+                String s(data.data() + start, end - start);
+                if (filter(s)) {
+                    chunk.m_cols = std::max(chunk.m_cols, int(end - start));
+                    chunk.m_lines.push_back(std::move(s));
+                }
+                start = end + 1;
+            }
+        }
+    });
+
+    int rows = 0;
+    int cols = 0;
+    for (Chunk& chunk : chunks) {
+        rows += int(chunk.m_lines.size());
+        cols = std::max(cols, chunk.m_cols);
+        for (String& line : chunk.m_lines)
+            textLines.Append(std::move(line));
+    }
+    return TableDimensions(cols, rows);
+}
+
+// =================================================================================================
+
+static inline bool IsSeparator(char c) {
+    return (c == ' ') or (c == '\t') or (c == ',') or (c == ';') or (c == '\r');
+}
+
+
+template <typename T>
+static inline const char* ParseValue(const char* s, const char* end, T& value) {
+    if ((s < end) and (*s == '+'))
+        ++s;
+    std::from_chars_result result = std::from_chars(s, end, value);
+    if (result.ec != std::errc())
+        value = T(0);
+    while ((s < end) and not IsSeparator(*s))
+        ++s;
+    return s;
+}
+
+
+// Two passes over the file contents: the first one measures the grid, the second one fills it.
+template <typename T>
+TableDimensions TextFileLoader::ReadTable(const char* fileName, Table<T>& table, TableLayout layout, std::pmr::memory_resource* resource) {
+    TRACE_ZONE("TextFileLoader::ReadTable");
+    std::pmr::string data(resource ? resource : std::pmr::get_default_resource());
+    if (not ReadFile(fileName, data))
+        return TableDimensions(0,0);
+    const char* end = data.data() + data.length();
+
+    // call f(first, last) for every row
+    auto forEachRow = [&](auto&& f) {
+        for (const char* s = data.data(); s < end; ) {
+            const char* e = static_cast<const char*>(memchr(s, '\n', size_t(end - s)));
+            if (not e)
+                e = end;
+            const char* last = e;
+            if ((last > s) and (last[-1] == '\r'))
+                --last;
+            if constexpr (std::is_same<T, char>::value)
+                f(s, last);
+            else if ((last > s) and (*s != '#') and (std::find_if_not(s, last, IsSeparator) != last))
+                f(s, last);
+            s = e + 1;
+        }
+    };
+
+    int rows = 0;
+    int cols = 0;
+    forEachRow([&](const char* s, const char* e) {
+        int n = 0;
+        if constexpr (std::is_same<T, char>::value)
+            n = int(e - s);
+        else
+            for (s = std::find_if_not(s, e, IsSeparator); s < e; s = std::find_if_not(s, e, IsSeparator), n++)
+                s = std::find_if(s, e, IsSeparator);
+        cols = std::max(cols, n);
+        rows++;
+    });
+    if (not table.Create(cols, rows, layout, table.TileSize()))
+        return TableDimensions(0,0);
+    if constexpr (std::is_same<T, char>::value)
+        table.Fill(' ');
+
+    int row = 0;
+    forEachRow([&](const char* s, const char* e) {
+        if constexpr (std::is_same<T, char>::value) {
+            if (layout == TableLayout::RowMajor)
+                memcpy(table.RowData(row), s, size_t(e - s));
+            else
+                for (int col = 0; s < e; col++)
+                    table(col, row) = *s++;
+        }
+        else {
+            for (int col = 0; (s = std::find_if_not(s, e, IsSeparator)) < e; col++)
+                s = ParseValue(s, e, table(col, row));
+        }
+        row++;
+    });
+    return TableDimensions(cols, rows);
+}
+
+
+template TableDimensions TextFileLoader::ReadTable<char>(const char*, Table<char>&, TableLayout, std::pmr::memory_resource*);
+template TableDimensions TextFileLoader::ReadTable<uint8_t>(const char*, Table<uint8_t>&, TableLayout, std::pmr::memory_resource*);
+template TableDimensions TextFileLoader::ReadTable<int16_t>(const char*, Table<int16_t>&, TableLayout, std::pmr::memory_resource*);
+template TableDimensions TextFileLoader::ReadTable<uint16_t>(const char*, Table<uint16_t>&, TableLayout, std::pmr::memory_resource*);
+template TableDimensions TextFileLoader::ReadTable<int>(const char*, Table<int>&, TableLayout, std::pmr::memory_resource*);
+template TableDimensions TextFileLoader::ReadTable<uint32_t>(const char*, Table<uint32_t>&, TableLayout, std::pmr::memory_resource*);
+template TableDimensions TextFileLoader::ReadTable<float>(const char*, Table<float>&, TableLayout, std::pmr::memory_resource*);
+template TableDimensions TextFileLoader::ReadTable<double>(const char*, Table<double>&, TableLayout, std::pmr::memory_resource*);
+
 // =================================================================================================
@@ -0,0 +1,301 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string_view>
+#include <algorithm>
+#include <charconv>
+
+#include "timesync.h"
+
+// =================================================================================================
+
+TimeSync::TimeSync(UDP& udp, const TimeSyncParams& params)
+    : m_udp(udp), m_params(params), m_epoch(NetworkStats::Now()), m_jitterState(0x9E3779B9), m_answered(0), m_bytesSent(0)
+{
+    m_params.filterSize = std::clamp(m_params.filterSize, 1, 64);
+    m_params.minSamples = std::clamp(m_params.minSamples, 1, m_params.filterSize);
+}
+
+
+int64_t TimeSync::Clock(uint64_t now) const {
+    int64_t clock = int64_t(now) + m_params.simulatedOffset;
+    if (m_params.simulatedDrift != 0.0f)
+        clock += int64_t(double(now - m_epoch) * double(m_params.simulatedDrift) * 1e-6);
+    return clock;
+}
+
+
+void TimeSync::AddPeer(const UDPPeer& peer) {
+    if (not peer.IsValid())
+        return;
+    PeerClock& clock = m_peers[peer.m_target.Key()];
+    clock.m_peer = peer;
+    clock.m_isProbed = true;
+    clock.m_burstLeft = m_params.burstCount;
+    clock.m_nextProbe = NetworkStats::Now();
+}
+
+
+bool TimeSync::RemovePeer(const UDPPeer& peer) {
+    return m_peers.erase(peer.m_target.Key()) > 0;
+}
+
+
+const TimeSync::PeerClock* TimeSync::Find(const UDPPeer& peer) const {
+    auto it = m_peers.find(peer.m_target.Key());
+    return (it == m_peers.end()) ? nullptr : &it->second;
+}
+
+// =================================================================================================
+
+void TimeSync::Send(const UDPPeer& peer, const char* data, size_t length) {
+    m_bytesSent += UDP_MESSAGE_PREFIX_LENGTH + length;
+    if (m_params.simulatedDelay <= 0) {
+        m_udp.Transmit(peer, data, length);
+        return;
+    }
+    uint64_t delay = uint64_t(m_params.simulatedDelay);
+    if (m_params.simulatedJitter > 0) {
+        m_jitterState ^= m_jitterState << 13;
+        m_jitterState ^= m_jitterState >> 17;
+        m_jitterState ^= m_jitterState << 5;
+        delay += m_jitterState % uint32_t(m_params.simulatedJitter + 1);
+    }
+    m_held.push_back(Held{ NetworkStats::Now() + delay, peer, std::string(data, length) });
+}
+
+
+void TimeSync::Probe(PeerClock& peer, uint64_t now) {
+    char probe[64];
+    int l = snprintf(probe, sizeof(probe), "@tsync#%u:%llx", unsigned(m_udp.InPort()), (unsigned long long) Clock(now));
+    Send(peer.m_peer, probe, size_t(l));
+    peer.m_pending[peer.m_nextPending] = uint64_t(Clock(now));
+    peer.m_nextPending = (peer.m_nextPending + 1) % int(sizeof(peer.m_pending) / sizeof(peer.m_pending[0]));
+    ++peer.m_probes;
+    int interval = m_params.interval;
+    if (peer.m_burstLeft > 0)
+        interval = (--peer.m_burstLeft > 0) ? m_params.burstInterval : m_params.interval;
+    peer.m_nextProbe = now + uint64_t(std::max(interval, 1)) * 1000;
+}
+
+
+// t1 is echoed as received; t3 is taken as late as possible, right before sending
+void TimeSync::Answer(const UDPPeer& peer, uint64_t t1, int64_t t2) {
+    char reply[96];
+    int l = snprintf(reply, sizeof(reply), "@tsack#%u:%llx:%llx:%llx", unsigned(m_udp.InPort()),
+                     (unsigned long long) t1, (unsigned long long) t2, (unsigned long long) Clock());
+    Send(peer, reply, size_t(l));
+    ++m_answered;
+}
+
+
+int TimeSync::Update(void) {
+    uint64_t now = NetworkStats::Now();
+    int n = 0;
+    for (auto it = m_held.begin(); it != m_held.end(); ) {
+        if (it->m_due > now)
+            ++it;
+        else {
+            m_udp.Transmit(it->m_peer, it->m_data.data(), it->m_data.length());
+            it = m_held.erase(it);
+            ++n;
+        }
+    }
+    for (auto& [key, peer] : m_peers)
+        if (peer.m_isProbed and (peer.m_nextProbe <= now)) {
+            Probe(peer, now);
+            ++n;
+        }
+    return n;
+}
+
+// =================================================================================================
+
+// read the field behind separator at s (not beyond end) as a number of base; moves s behind it
+static bool ParseField(const char*& s, const char* end, char separator, int base, uint64_t& value) {
+    if ((s >= end) or (*s != separator))
+        return false;
+    auto [next, error] = std::from_chars(s + 1, end, value, base);
+    if ((error != std::errc()) or (next == s + 1))
+        return false;
+    s = next;
+    return true;
+}
+
+
+// The payload comes from the network: every field is checked to lie within it, and anything
+// malformed is dropped (still returning true, as it is a sync message nobody else can handle).
+bool TimeSync::Decode(Message& message) {
+    std::string_view keyword = message.Keyword();
+    bool isProbe = (keyword == "@tsync");
+    if (not isProbe and (keyword != "@tsack"))
+        return false;
+    // the receive time stamp of pooled messages is closer to the wire than now
+    uint64_t now = (message.m_arena and message.m_arena->m_receiveTime) ? message.m_arena->m_receiveTime : NetworkStats::Now();
+    int64_t received = Clock(now);
+    UDPAddress sender;
+    if (not sender.ParseHost(message.Address()))
+        return true;
+    const char* s = message.Payload() + keyword.length();
+    const char* end = message.Payload() + message.PayloadLength();
+    uint64_t port, t1;
+    if (not (ParseField(s, end, '#', 10, port) and (port > 0) and (port <= 0xFFFF) and ParseField(s, end, ':', 16, t1)))
+        return true;
+    sender.SetPort(uint16_t(port));
+
+    if (isProbe) {
+        if (s != end)
+            return true;
+        UDPPeer peer;
+        peer.m_address = String(message.Address());
+        peer.m_port = uint16_t(port);
+        peer.m_target = sender;
+        peer.m_isValid = true;
+        Answer(peer, t1, received);
+        return true;
+    }
+
+    uint64_t t2, t3;
+    if (not (ParseField(s, end, ':', 16, t2) and ParseField(s, end, ':', 16, t3) and (s == end)))
+        return true;
+    auto it = m_peers.find(sender.Key());
+    if (it == m_peers.end()) // reply to a probe of a removed peer
+        return true;
+    PeerClock& peer = it->second;
+    uint64_t* pending = std::find(std::begin(peer.m_pending), std::end(peer.m_pending), t1);
+    if ((t1 == 0) or (pending == std::end(peer.m_pending))) {
+        ++peer.m_rejected;
+        return true;
+    }
+    *pending = 0;   // a duplicate of this reply is rejected
+    AddSample(peer, int64_t(t1), int64_t(t2), int64_t(t3), received);
+    return true;
+}
+
+
+void TimeSync::AddSample(PeerClock& peer, int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+    int64_t delay = (t4 - t1) - (t3 - t2);
+    if ((t4 < t1) or (t3 < t2) or (delay < 0)) {
+        ++peer.m_rejected;
+        return;
+    }
+    ++peer.m_replies;
+    Sample& sample = peer.m_samples[peer.m_nextSample];
+    sample.m_time = t4;
+    sample.m_offset = ((t2 - t1) + (t3 - t4)) / 2;
+    sample.m_delay = delay;
+    peer.m_nextSample = (peer.m_nextSample + 1) % m_params.filterSize;
+    peer.m_sampleCount = std::min(peer.m_sampleCount + 1, m_params.filterSize);
+
+    float rtt = float(delay);
+    if (peer.m_srtt == 0.0f) {
+        peer.m_srtt = rtt;
+        peer.m_rttVar = rtt / 2.0f;
+    }
+    else {
+        peer.m_rttVar = 0.75f * peer.m_rttVar + 0.25f * fabsf(peer.m_srtt - rtt);
+        peer.m_srtt = 0.875f * peer.m_srtt + 0.125f * rtt;
+    }
+    m_udp.m_stats.m_rtt.Record(uint64_t(delay));
+    m_udp.m_stats.Peer(peer.m_peer.m_target).m_rtt.Record(uint64_t(delay));
+    Estimate(peer);
+}
+
+
+// fit offset and drift to the better half of the samples by delay (at least to those within
+// delayMargin of the minimum)
+void TimeSync::Estimate(PeerClock& peer) {
+    const Sample* best = &peer.m_samples[0];
+    int64_t delays[64];
+    for (int i = 0; i < peer.m_sampleCount; i++) {
+        delays[i] = peer.m_samples[i].m_delay;
+        if (peer.m_samples[i].m_delay < best->m_delay)
+            best = &peer.m_samples[i];
+    }
+    peer.m_minDelay = best->m_delay;
+    std::nth_element(delays, delays + peer.m_sampleCount / 2, delays + peer.m_sampleCount);
+
+    int64_t limit = std::max(best->m_delay + m_params.delayMargin, delays[peer.m_sampleCount / 2]);
+    int64_t first = best->m_time, last = best->m_time;
+    int n = 0;
+    double sumX = 0.0, sumY = 0.0;
+    for (int i = 0; i < peer.m_sampleCount; i++) {
+        const Sample& sample = peer.m_samples[i];
+        if (sample.m_delay > limit)
+            continue;
+        first = std::min(first, sample.m_time);
+        last = std::max(last, sample.m_time);
+        sumX += double(sample.m_time - best->m_time);
+        sumY += double(sample.m_offset);
+        ++n;
+    }
+    if ((n < 3) or (last - first < int64_t(m_params.minDriftSpan) * 1000)) {
+        peer.m_reference = best->m_time;
+        peer.m_offset = double(best->m_offset);
+        return;
+    }
+    double meanX = sumX / n, meanY = sumY / n;
+    double sxx = 0.0, sxy = 0.0;
+    for (int i = 0; i < peer.m_sampleCount; i++) {
+        const Sample& sample = peer.m_samples[i];
+        if (sample.m_delay > limit)
+            continue;
+        double dx = double(sample.m_time - best->m_time) - meanX;
+        sxx += dx * dx;
+        sxy += dx * (double(sample.m_offset) - meanY);
+    }
+    peer.m_drift = sxy / sxx;
+    peer.m_reference = best->m_time + int64_t(meanX);
+    peer.m_offset = meanY;
+}
+
+// =================================================================================================
+
+bool TimeSync::IsSynchronized(const UDPPeer& peer) const {
+    const PeerClock* clock = Find(peer);
+    return clock and (clock->m_sampleCount >= m_params.minSamples);
+}
+
+
+double TimeSync::Offset(const UDPPeer& peer, int64_t time) const {
+    const PeerClock* clock = Find(peer);
+    if (not clock or (clock->m_sampleCount == 0))
+        return 0.0;
+    if (time == 0)
+        time = Clock();
+    return clock->m_offset + clock->m_drift * double(time - clock->m_reference);
+}
+
+
+double TimeSync::Drift(const UDPPeer& peer) const {
+    const PeerClock* clock = Find(peer);
+    return clock ? clock->m_drift * 1e6 : 0.0;
+}
+
+
+float TimeSync::RoundTripTime(const UDPPeer& peer) const {
+    const PeerClock* clock = Find(peer);
+    return clock ? clock->m_srtt : 0.0f;
+}
+
+
+std::string TimeSync::ToText(void) const {
+    std::string text;
+    char line[320];
+    snprintf(line, sizeof(line), "time sync: %llu probes answered, %llu bytes sent\n", (unsigned long long) m_answered, (unsigned long long) m_bytesSent);
+    text += line;
+    for (const auto& [key, peer] : m_peers) {
+        char host[16];
+        peer.m_peer.m_target.FormatHost(host);
+        snprintf(line, sizeof(line), "%s:%u: %s, offset %.0f us, drift %.2f ppm, rtt %.0f us (min %lld), %llu probes, %llu replies, %llu rejected\n",
+                 host, unsigned(peer.m_peer.m_port), (peer.m_sampleCount >= m_params.minSamples) ? "synchronized" : "unsynchronized",
+                 (peer.m_sampleCount > 0) ? peer.m_offset + peer.m_drift * double(Clock() - peer.m_reference) : 0.0, peer.m_drift * 1e6,
+                 double(peer.m_srtt), (long long) peer.m_minDelay, (unsigned long long) peer.m_probes,
+                 (unsigned long long) peer.m_replies, (unsigned long long) peer.m_rejected);
+        text += line;
+    }
+    return text;
+}
+
+// =================================================================================================
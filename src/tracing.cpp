@@ -0,0 +1,98 @@
+#include <stdio.h>
+
+#include "tracing.h"
+
+// =================================================================================================
+
+std::atomic<bool> Tracing::m_isEnabled(false);
+Tracing::tClock::time_point Tracing::m_start = Tracing::tClock::now();
+std::mutex Tracing::m_lock;
+std::vector<std::unique_ptr<TraceBuffer>> Tracing::m_buffers;
+
+
+void Tracing::Enable(bool enable) {
+    m_isEnabled.store(enable, std::memory_order_relaxed);
+}
+
+
+TraceBuffer* Tracing::Register(void) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_buffers.emplace_back(new TraceBuffer(uint32_t(m_buffers.size() + 1)));
+    return m_buffers.back().get();
+}
+
+
+static void WriteName(FILE* file, const char* name) {
+    fputc('"', file);
+    for (const char* c = name; *c; c++) {
+        if ((*c == '"') or (*c == '\\'))
+            fputc('\\', file);
+        if (uint8_t(*c) >= 0x20)
+            fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+
+bool Tracing::Export(const char* fileName) {
+    FILE* file = fopen(fileName, "w");
+    if (not file) {
+        fprintf(stderr, "Tracing: couldn't create '%s'\n", fileName);
+        return false;
+    }
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file);
+    bool first = true;
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (const auto& buffer : m_buffers) {
+        const char* threadName = buffer->m_threadName.load(std::memory_order_relaxed);
+        if (threadName) {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", buffer->m_threadId);
+            WriteName(file, threadName);
+            fputs("}}", file);
+            first = false;
+        }
+        uint32_t count = buffer->m_count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < count; i++) {
+            const TraceEvent& event = buffer->m_chunks[i / TRACE_CHUNK_SIZE]->m_events[i % TRACE_CHUNK_SIZE];
+            fputs(first ? "{\"name\":" : ",\n{\"name\":", file);
+            WriteName(file, event.m_name);
+            if (event.m_duration == UINT64_MAX)
+                fprintf(file, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}", double(event.m_start) / 1000.0, buffer->m_threadId);
+            else
+                fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                        double(event.m_start) / 1000.0, double(event.m_duration) / 1000.0, buffer->m_threadId);
+            first = false;
+        }
+    }
+    fputs("\n]}\n", file);
+    return fclose(file) == 0;
+}
+
+
+void Tracing::Clear(void) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (auto& buffer : m_buffers) {
+        buffer->m_count.store(0, std::memory_order_release);
+        buffer->m_dropped.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+uint64_t Tracing::EventCount(void) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    uint64_t n = 0;
+    for (const auto& buffer : m_buffers)
+        n += buffer->m_count.load(std::memory_order_relaxed);
+    return n;
+}
+
+
+uint64_t Tracing::DroppedCount(void) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    uint64_t n = 0;
+    for (const auto& buffer : m_buffers)
+        n += buffer->m_dropped.load(std::memory_order_relaxed);
+    return n;
+}
+
+// =================================================================================================
@@ -1,18 +1,39 @@
 #include "udp.h"
+#include "tracing.h"
 
 // =================================================================================================
-// UDP based networking
+// UDP based networking - SDL_net backend. The native backend is in udp_posix.cpp.
 
-bool UDPSocket::Open(String localAddress, uint16_t localPort) {
+#if !USE_POSIX_SOCKETS
+
+bool UDPPeer::Resolve(String address, uint16_t port) {
+    m_address = address;
+    m_port = port;
+    IPaddress ip;
+    m_isValid = (0 <= SDLNet_ResolveHost(&ip, (char*) address, port));
+    if (not m_isValid)
+        fprintf(stderr, "Failed to resolve host '%s:%d'\n", (char*) address, port);
+    else
+        m_target = UDPAddress(ip.host, ip.port);
+    return m_isValid;
+}
+
+
+bool UDPSocket::Open(String localAddress, uint16_t localPort, const UDPSocketParams& params) {
+    Close();
     m_localAddress = localAddress;
     m_localPort = localPort;
+    m_params = params;
     if (localAddress == "127.0.0.1") {
         fprintf(stderr, "UDP OpenSocket: Please specify a valid local network or internet address in the command line or ini file\n");
         return false;
     }
+    if (params.reusePort or not params.nonBlocking)
+        fprintf(stderr, "UDP OpenSocket: port sharing and blocking receive require the POSIX socket backend\n");
     if (not (m_socket = SDLNet_UDP_Open(localPort)))
         return false;
-    m_packet = SDLNet_AllocPacket(1500);
+    if (not m_packet)
+        m_packet = SDLNet_AllocPacket(1500);
     return m_isValid = true;
 }
 
@@ -46,35 +67,334 @@ bool UDPSocket::Send(String message, String address, uint16_t port) {
         return false;
     int n = SDLNet_UDP_Send(m_socket, m_channel, &packet);
     Unbind ();
-    return (n > 0);
+    if (n <= 0) {
+        m_traffic.SendFailed();
+        return false;
+    }
+    m_traffic.Sent(message.Length());
+    return true;
+}
+
+
+bool UDPSocket::Send(const UDPPeer& peer, const char* prefix, size_t prefixLength, const char* message, size_t length) {
+    if (not (m_isValid and peer.IsValid()))
+        return false;
+    if (not m_buffer.Assign(peer.m_target, prefix, prefixLength, message, length))
+        return false;
+    UDPpacket packet = { -1, m_buffer.m_data, int (m_buffer.m_length), UDP_MAX_DATAGRAM_SIZE, 0, { peer.m_target.m_host, peer.m_target.m_port } };
+    if (SDLNet_UDP_Send(m_socket, -1, &packet) <= 0) {
+        m_traffic.SendFailed();
+        return false;
+    }
+    m_traffic.Sent(m_buffer.m_length);
+    return true;
 }
 
 
+// SDLNet_UDP_SendV is SDL_net's vectored send: all queued datagrams go out in one call.
+int UDPSocket::SendBatch(UDPSendQueue& queue) {
+    if (not m_isValid)
+        return -1;
+    int count = int(queue.Length());
+    if (count == 0)
+        return 0;
+    UDPpacket** packets = PacketVector(queue.m_slots, uint32_t(count));
+    for (int i = 0; i < count; i++) {
+        packets[i]->len = queue.m_slots[i].m_length;
+        packets[i]->address.host = queue.m_slots[i].m_address.m_host;
+        packets[i]->address.port = queue.m_slots[i].m_address.m_port;
+    }
+    int n = SDLNet_UDP_SendV(m_socket, packets, count);
+    CountSent(queue, n);
+    ++queue.m_flushes;
+    queue.Clear();
+    return n;
+}
+
+
+// Receiving doesn't need a bound channel: SDLNet_UDP_Recv reports unbound senders with channel -1,
+// and the sender address is in the packet anyway. So the socket is read directly.
 String UDPSocket::Receive(String& address, uint16_t& port) {
     if (not m_isValid)
         return String ("");
-    if (0 > (m_packet->channel = Bind(m_localAddress, m_localPort)))
+    if (0 >= SDLNet_UDP_Recv(m_socket, m_packet))
         return String("");
-    int n = SDLNet_UDP_Recv(m_socket, m_packet);
-    Unbind();
-    if (n <= 0)
-        return String("");
-    uint8_t* p = (uint8_t*)&m_packet->address.host;
+    UDPAddress sender(m_packet->address.host, m_packet->address.port);
     char s[16];
-    sprintf_s(s, sizeof (s), "%hu.%hu.%hu.%hu", p[0], p[1], p[2], p[3]);
+    sender.FormatHost(s);
     address = s;
-    port = uint16_t(m_packet->address.port);
+    port = sender.Port();
     return String((const char*)m_packet->data, m_packet->len);
 }
 
 
+UDPpacket** UDPSocket::PacketVector(UDPDatagram* slots, uint32_t count) {
+    if (m_packetHeaders.size() < count) {
+        m_packetHeaders.resize(count);
+        m_packetVector.resize(count + 1);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        UDPpacket& packet = m_packetHeaders[i];
+        packet.channel = -1;
+        packet.data = slots[i].m_data;
+        packet.len = 0;
+        packet.maxlen = UDP_MAX_DATAGRAM_SIZE;
+        packet.status = 0;
+        m_packetVector[i] = &packet;
+    }
+    m_packetVector[count] = nullptr;
+    return m_packetVector.data();
+}
+
+
+// SDLNet_UDP_RecvV reads packets until either the socket has no more data or the vector is full.
+// SDL_net sockets never block on receive, so wait is irrelevant here.
+int UDPSocket::ReceiveBatch(UDPDatagram* slots, uint32_t count, bool wait) {
+    if (not m_isValid)
+        return -1;
+    UDPpacket** packets = PacketVector(slots, count);
+    int n = SDLNet_UDP_RecvV(m_socket, packets);
+    for (int i = 0; i < n; i++) {
+        slots[i].m_address = UDPAddress(packets[i]->address.host, packets[i]->address.port);
+        slots[i].m_length = uint16_t(packets[i]->len);
+    }
+    return n;
+}
+
+
+#endif
+
+// =================================================================================================
+
+bool UDPSocket::Receive(UDPDatagram& datagram) {
+    while (ReceiveBatch(&datagram, 1, true) > 0)
+        if ((m_params.simulatedLoss <= 0.0f) or (SimulateLoss(&datagram, 1) > 0)) {
+            m_traffic.Received(datagram.m_length);
+            return true;
+        }
+    return false;
+}
+
+
+void UDPSocket::CountSent(const UDPSendQueue& queue, int sent) {
+    size_t bytes = 0;
+    for (int i = 0; i < sent; i++)
+        bytes += queue.m_slots[i].m_length;
+    if (sent > 0)
+        m_traffic.Sent(bytes, uint64_t(sent));
+    if (sent < int(queue.Length()))
+        m_traffic.SendFailed(queue.Length() - uint32_t((sent > 0) ? sent : 0));
+}
+
+
+// one receive call per contiguous span of free ring slots drains the socket
+int UDPSocket::ReceiveBatch(UDPDatagramRing& ring) {
+    if (not m_isValid)
+        return -1;
+    ++ring.m_drains;
+    int total = 0;
+    for (bool wait = true; not ring.IsFull(); wait = false) {
+        uint32_t length;
+        UDPDatagram* slots = ring.FreeSpan(length);
+        int n = ReceiveBatch(slots, length, wait);
+        if (n < 0)
+            return (total > 0) ? total : -1;
+        int kept = (m_params.simulatedLoss > 0.0f) ? SimulateLoss(slots, n) : n;
+        size_t bytes = 0;
+        for (int i = 0; i < kept; i++)
+            bytes += slots[i].m_length;
+        m_traffic.Received(bytes, uint64_t(kept));
+        ring.Commit(uint32_t(kept));
+        total += kept;
+        if (uint32_t(n) < length)
+            return total;
+    }
+    ++ring.m_overflows;
+    return total;
+}
+
+
+int UDPSocket::SimulateLoss(UDPDatagram* slots, int count) {
+    uint32_t threshold = (m_params.simulatedLoss >= 1.0f) ? 0xFFFFFFFF : uint32_t(m_params.simulatedLoss * 4294967296.0);
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        m_lossState ^= m_lossState << 13; // xorshift32
+        m_lossState ^= m_lossState >> 17;
+        m_lossState ^= m_lossState << 5;
+        if (m_lossState < threshold)
+            ++m_simulatedDrops;
+        else if (kept++ != i)
+            slots[kept - 1] = slots[i];
+    }
+    return kept;
+}
+
+
+bool UDP::NextMessage(const UDPDatagram& datagram, uint16_t& offset, Message& message) {
+    if ((offset == 0) and datagram.HasPrefix(UDP_MESSAGE_PREFIX, UDP_MESSAGE_PREFIX_LENGTH))
+        offset = UDP_MESSAGE_PREFIX_LENGTH;
+    while (offset < datagram.m_length) {
+        const char* data = datagram.Data() + offset;
+        size_t length = datagram.m_length - offset;
+        const char* end = static_cast<const char*>(memchr(data, UDP_MESSAGE_SEPARATOR, length));
+        if (end)
+            length = size_t(end - data);
+        offset += uint16_t(length + (end != nullptr));
+        if (length > 0) {
+            char host[16];
+            datagram.m_address.FormatHost(host);
+            message.Assign(data, length, host, datagram.m_address.Port());
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool UDP::EnableSharedMemory(uint32_t capacity) {
+    UDPAddress source;
+    if ((m_localAddress == "0.0.0.0") or not source.ParseHost((char*) m_localAddress))
+        source.ParseHost("127.0.0.1");
+    source.SetPort(OutPort());
+    return m_sharedMemory.Open(InPort(), source, capacity);
+}
+
+
+size_t UDP::Compress(const char*& prefix, const char*& message, size_t length, uint8_t* buffer) {
+    if (not m_compressor.m_isEnabled or (length < m_compressor.m_minLength))
+        return length;
+    size_t compressed = m_compressor.Compress(reinterpret_cast<const uint8_t*>(message), length, buffer, length - 1);
+    if (compressed == 0)
+        return length;
+    prefix = UDP_COMPRESSED_PREFIX;
+    message = reinterpret_cast<const char*>(buffer);
+    return compressed;
+}
+
+
+// peer statistics and captures see messages as they are before compression; socket statistics count what goes on the wire
+bool UDP::Transmit(const UDPPeer& peer, const char* message, size_t length) {
+    if (not peer.IsValid())
+        return false;
+    if (m_recorder)
+        m_recorder->Record(true, peer.m_target, UDP_MESSAGE_PREFIX, UDP_MESSAGE_PREFIX_LENGTH, message, length);
+    PeerStats& stats = m_stats.Peer(peer.m_target);
+    if (m_sharedMemory.Send(peer.m_target, UDP_MESSAGE_PREFIX, UDP_MESSAGE_PREFIX_LENGTH, message, length)) {
+        stats.Sent(UDP_MESSAGE_PREFIX_LENGTH + length);
+        return true;
+    }
+    const char* prefix = UDP_MESSAGE_PREFIX;
+    const char* data = message;
+    uint8_t buffer[UDP_MAX_DATAGRAM_SIZE];
+    if (m_sockets[1].Send(peer, prefix, UDP_MESSAGE_PREFIX_LENGTH, data, Compress(prefix, data, length, buffer))) {
+        stats.Sent(UDP_MESSAGE_PREFIX_LENGTH + length);
+        return true;
+    }
+    stats.SendFailed();
+    return false;
+}
+
+
+// queued datagrams count as sent for the peer statistics; the socket statistics count what actually left
+bool UDP::Queue(const UDPAddress& target, const char* message, size_t length) {
+    if (m_recorder)
+        m_recorder->Record(true, target, UDP_MESSAGE_PREFIX, UDP_MESSAGE_PREFIX_LENGTH, message, length);
+    PeerStats& stats = m_stats.Peer(target);
+    if (m_sharedMemory.Send(target, UDP_MESSAGE_PREFIX, UDP_MESSAGE_PREFIX_LENGTH, message, length)) {
+        stats.Sent(UDP_MESSAGE_PREFIX_LENGTH + length);
+        return true;
+    }
+    if (m_sendQueue.IsFull())
+        Flush();
+    const char* prefix = UDP_MESSAGE_PREFIX;
+    const char* data = message;
+    uint8_t buffer[UDP_MAX_DATAGRAM_SIZE];
+    if (not m_sendQueue.Queue(target, prefix, UDP_MESSAGE_PREFIX_LENGTH, data, Compress(prefix, data, length, buffer))) {
+        stats.SendFailed();
+        return false;
+    }
+    stats.Sent(UDP_MESSAGE_PREFIX_LENGTH + length);
+    m_stats.m_sendQueue.Set(m_sendQueue.Length());
+    return true;
+}
+
+
 Message UDP::Receive(void) {
+    TRACE_ZONE("UDP::Receive");
     Message data;
-    data.m_payload = m_sockets[0].Receive(data.m_address, data.m_port);
-    if (data.m_payload.Find("SMIBAT") == 0)
-        data.m_payload = data.m_payload.Replace("SMIBAT", "", 1);
+    if (NextMessage(m_datagram, m_datagramOffset, data))
+        return data;
+    m_datagramOffset = 0;
+    m_datagram.m_length = 0;
+    if (ReceiveDatagram(m_datagram))
+        NextMessage(m_datagram, m_datagramOffset, data);
     return data;
 }
 
 
+bool UDP::ReceiveDatagram(UDPDatagram& datagram) {
+    if (m_replay) {
+        if (not m_replay->Next(datagram))
+            return false;
+    }
+    else if (not (m_sharedMemory.Receive(datagram) or m_sockets[0].Receive(datagram)))
+        return false;
+    Expand(datagram);
+    if (m_recorder and not m_replay)
+        m_recorder->Record(datagram);
+    CountReceived(datagram);
+    return true;
+}
+
+
+void UDP::Expand(UDPDatagram& datagram) {
+    if (not datagram.HasPrefix(UDP_COMPRESSED_PREFIX, UDP_MESSAGE_PREFIX_LENGTH))
+        return;
+    uint8_t* payload = datagram.m_data + UDP_MESSAGE_PREFIX_LENGTH;
+    int length = m_compressor.Expand(payload, datagram.m_length - UDP_MESSAGE_PREFIX_LENGTH, payload, UDP_MAX_DATAGRAM_SIZE - UDP_MESSAGE_PREFIX_LENGTH);
+    if (length < 0) {
+        datagram.m_length = 0;
+        return;
+    }
+    memcpy(datagram.m_data, UDP_MESSAGE_PREFIX, UDP_MESSAGE_PREFIX_LENGTH);
+    datagram.m_length = uint16_t(UDP_MESSAGE_PREFIX_LENGTH + length);
+}
+
+
+void UDP::CountReceived(const UDPDatagram& datagram) {
+    m_stats.Peer(datagram.m_address).Received(datagram.m_length);
+    if (not datagram.HasPrefix(UDP_MESSAGE_PREFIX, UDP_MESSAGE_PREFIX_LENGTH))
+        m_stats.m_prefixMismatches.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+int UDP::ReceiveBatch(UDPDatagramRing& ring) {
+    TRACE_ZONE("UDP::ReceiveBatch");
+    uint32_t count = ring.Length();
+    int n;
+    if (m_replay)
+        n = m_replay->ReceiveBatch(ring);
+    else {
+        n = m_sharedMemory.ReceiveBatch(ring);
+        if (not ring.IsFull()) {
+            int m = m_sockets[0].ReceiveBatch(ring);
+            if (m < 0) {
+                if (n == 0)
+                    return m;
+            }
+            else
+                n += m;
+        }
+    }
+    for (uint32_t i = count; i < ring.Length(); i++) {
+        UDPDatagram& datagram = ring.m_slots[(ring.m_head + i) % ring.Capacity()];
+        Expand(datagram);
+        if (m_recorder and not m_replay)
+            m_recorder->Record(datagram);
+        CountReceived(datagram);
+    }
+    return n;
+}
+
+
 // =================================================================================================
@@ -0,0 +1,267 @@
+#include "udp.h"
+
+// =================================================================================================
+// UDP based networking - native POSIX socket backend (USE_POSIX_SOCKETS=1)
+// Datagrams are read and written directly from/to the ring slots. On Linux, batches are moved
+// with recvmmsg/sendmmsg, elsewhere with one recvfrom/sendto per datagram.
+
+#if USE_POSIX_SOCKETS
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+bool UDPPeer::Resolve(String address, uint16_t port) {
+    m_address = address;
+    m_port = port;
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo* result = nullptr;
+    m_isValid = (0 == getaddrinfo((char*) address, nullptr, &hints, &result)) and result;
+    if (not m_isValid)
+        fprintf(stderr, "Failed to resolve host '%s:%d'\n", (char*) address, port);
+    else {
+        m_target.m_host = reinterpret_cast<struct sockaddr_in*>(result->ai_addr)->sin_addr.s_addr;
+        m_target.m_port = htons(port);
+    }
+    if (result)
+        freeaddrinfo(result);
+    return m_isValid;
+}
+
+
+// The kernel caps buffer sizes (Linux: net.core.rmem_max / wmem_max) without failing, so the size
+// is read back. Linux reports twice the requested size (the rest is bookkeeping overhead).
+static void SetBufferSize(int socket, int option, int size, const char* name) {
+    if (0 > setsockopt(socket, SOL_SOCKET, option, &size, sizeof(size))) {
+        fprintf(stderr, "UDP OpenSocket: couldn't set %s to %d bytes (%s)\n", name, size, strerror(errno));
+        return;
+    }
+    int actual = 0;
+    socklen_t length = sizeof(actual);
+    if (0 > getsockopt(socket, SOL_SOCKET, option, &actual, &length))
+        return;
+#ifdef __linux__
+    actual /= 2;
+#endif
+    if (actual < size)
+        fprintf(stderr, "UDP OpenSocket: %s capped at %d bytes (%d requested)\n", name, actual, size);
+}
+
+
+bool UDPSocket::Open(String localAddress, uint16_t localPort, const UDPSocketParams& params) {
+    Close();
+    m_localAddress = localAddress;
+    m_localPort = localPort;
+    m_params = params;
+    if (localAddress == "127.0.0.1") {
+        fprintf(stderr, "UDP OpenSocket: Please specify a valid local network or internet address in the command line or ini file\n");
+        return false;
+    }
+    if (0 > (m_socket = socket(AF_INET, SOCK_DGRAM, 0)))
+        return false;
+    int enable = 1;
+#ifdef SO_REUSEPORT
+    if (params.reusePort and (0 > setsockopt(m_socket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable))))
+        fprintf(stderr, "UDP OpenSocket: couldn't enable port sharing (%s)\n", strerror(errno));
+#else
+    if (params.reusePort)
+        fprintf(stderr, "UDP OpenSocket: port sharing is not supported on this platform\n");
+#endif
+    if (params.receiveBufferSize > 0)
+        SetBufferSize(m_socket, SO_RCVBUF, params.receiveBufferSize, "receive buffer");
+    if (params.sendBufferSize > 0)
+        SetBufferSize(m_socket, SO_SNDBUF, params.sendBufferSize, "send buffer");
+    if (params.receiveTimeout > 0) {
+        struct timeval timeout = { params.receiveTimeout / 1000, (params.receiveTimeout % 1000) * 1000 };
+        setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+    if (params.nonBlocking)
+        fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL, 0) | O_NONBLOCK);
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(localPort);
+    if (0 > bind(m_socket, reinterpret_cast<struct sockaddr*>(&local), sizeof(local))) {
+        fprintf(stderr, "UDP OpenSocket: couldn't bind port %d (%s)\n", localPort, strerror(errno));
+        close(m_socket);
+        m_socket = -1;
+        return false;
+    }
+    return m_isValid = true;
+}
+
+
+void UDPSocket::Close(void) {
+    if (m_isValid) {
+        m_isValid = false;
+        close(m_socket);
+        m_socket = -1;
+    }
+}
+
+
+bool UDPSocket::Send(String message, String address, uint16_t port) {
+    UDPPeer peer(address, port);
+    return Send(peer, nullptr, 0, message.Data(), message.Length());
+}
+
+
+// scatter-gather send: prefix and message are written straight from their buffers
+bool UDPSocket::Send(const UDPPeer& peer, const char* prefix, size_t prefixLength, const char* message, size_t length) {
+    if (not (m_isValid and peer.IsValid()))
+        return false;
+    struct sockaddr_in target;
+    memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+    target.sin_addr.s_addr = peer.m_target.m_host;
+    target.sin_port = peer.m_target.m_port;
+    struct iovec parts[2] = { { const_cast<char*>(prefix), prefixLength }, { const_cast<char*>(message), length } };
+    struct msghdr header;
+    memset(&header, 0, sizeof(header));
+    header.msg_name = &target;
+    header.msg_namelen = sizeof(target);
+    header.msg_iov = parts;
+    header.msg_iovlen = 2;
+    if (sendmsg(m_socket, &header, 0) <= 0) {
+        m_traffic.SendFailed();
+        return false;
+    }
+    m_traffic.Sent(prefixLength + length);
+    return true;
+}
+
+
+void UDPSocket::PrepareVector(UDPDatagram* slots, uint32_t count, bool sending) {
+    if (m_iovecs.size() < count) {
+        m_iovecs.resize(count);
+        m_peers.resize(count);
+        m_truncated.resize(count);
+#ifdef __linux__
+        m_messages.resize(count);
+#endif
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        m_iovecs[i].iov_base = slots[i].m_data;
+        m_iovecs[i].iov_len = sending ? slots[i].m_length : UDP_MAX_DATAGRAM_SIZE;
+        if (sending) {
+            memset(&m_peers[i], 0, sizeof(m_peers[i]));
+            m_peers[i].sin_family = AF_INET;
+            m_peers[i].sin_addr.s_addr = slots[i].m_address.m_host;
+            m_peers[i].sin_port = slots[i].m_address.m_port;
+        }
+#ifdef __linux__
+        struct msghdr& header = m_messages[i].msg_hdr;
+        memset(&header, 0, sizeof(header));
+        header.msg_name = &m_peers[i];
+        header.msg_namelen = sizeof(m_peers[i]);
+        header.msg_iov = &m_iovecs[i];
+        header.msg_iovlen = 1;
+        m_messages[i].msg_len = 0;
+#endif
+    }
+}
+
+
+int UDPSocket::SendBatch(UDPSendQueue& queue) {
+    if (not m_isValid)
+        return -1;
+    uint32_t count = queue.Length();
+    if (count == 0)
+        return 0;
+    PrepareVector(queue.m_slots, count, true);
+    int sent = 0;
+#ifdef __linux__
+    while (sent < int(count)) {
+        int n = sendmmsg(m_socket, m_messages.data() + sent, count - sent, 0);
+        if (n <= 0) {
+            if ((n < 0) and (errno == EINTR))
+                continue;
+            break;
+        }
+        sent += n;
+    }
+#else
+    for (uint32_t i = 0; i < count; i++)
+        if (0 < sendto(m_socket, m_iovecs[i].iov_base, m_iovecs[i].iov_len, 0, reinterpret_cast<struct sockaddr*>(&m_peers[i]), sizeof(m_peers[i])))
+            ++sent;
+#endif
+    CountSent(queue, sent);
+    ++queue.m_flushes;
+    queue.Clear();
+    return sent;
+}
+
+
+String UDPSocket::Receive(String& address, uint16_t& port) {
+    if (not Receive(m_buffer))
+        return String("");
+    char s[16];
+    m_buffer.m_address.FormatHost(s);
+    address = s;
+    port = m_buffer.m_address.Port();
+    return String(m_buffer.Data(), m_buffer.m_length);
+}
+
+
+// A blocking socket waits for the first datagram (or the receive timeout) if wait is set; everything
+// after that is only read if it's already pending. Datagrams larger than a slot arrive cut off
+// (MSG_TRUNC); they are dropped and counted instead of being handed on incomplete.
+int UDPSocket::ReceiveBatch(UDPDatagram* slots, uint32_t count, bool wait) {
+    if (not m_isValid)
+        return -1;
+    PrepareVector(slots, count, false);
+    bool block = wait and not m_params.nonBlocking;
+    int n = 0;
+#ifdef __linux__
+    n = recvmmsg(m_socket, m_messages.data(), count, block ? MSG_WAITFORONE : MSG_DONTWAIT, nullptr);
+    if (n < 0)
+        return ((errno == EAGAIN) or (errno == EWOULDBLOCK) or (errno == EINTR)) ? 0 : -1;
+    for (int i = 0; i < n; i++) {
+        slots[i].m_length = uint16_t(m_messages[i].msg_len);
+        m_truncated[i] = (m_messages[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+    }
+#else
+    for (; n < int(count); n++) {
+        struct msghdr header;
+        memset(&header, 0, sizeof(header));
+        header.msg_name = &m_peers[n];
+        header.msg_namelen = sizeof(m_peers[n]);
+        header.msg_iov = &m_iovecs[n];
+        header.msg_iovlen = 1;
+        ssize_t l = recvmsg(m_socket, &header, ((n == 0) and block) ? 0 : MSG_DONTWAIT);
+        if (l < 0) {
+            if ((errno == EAGAIN) or (errno == EWOULDBLOCK) or (errno == EINTR))
+                break;
+            if (n == 0)
+                return -1;
+            break;
+        }
+        slots[n].m_length = uint16_t(l);
+        m_truncated[n] = (header.msg_flags & MSG_TRUNC) != 0;
+    }
+#endif
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        if (m_truncated[i]) {
+            ++m_truncatedDrops;
+            continue;
+        }
+        if (kept != i)
+            slots[kept] = slots[i];
+        slots[kept++].m_address = UDPAddress(m_peers[i].sin_addr.s_addr, m_peers[i].sin_port);
+    }
+    // all of them were dropped: look for more without waiting, so callers don't take 0 for "drained"
+    if ((kept == 0) and (n > 0))
+        return ReceiveBatch(slots, count, false);
+    return kept;
+}
+
+#endif
+
+// =================================================================================================
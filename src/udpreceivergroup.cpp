@@ -0,0 +1,72 @@
+#include <chrono>
+
+#include "udpreceivergroup.h"
+
+// =================================================================================================
+
+bool UDPReceiverGroup::Start(String localAddress, uint16_t port, int receiverCount, tHandler handler, UDPSocketParams params, uint32_t ringCapacity) {
+    Stop();
+#if !USE_POSIX_SOCKETS
+    if (receiverCount > 1) {
+        fprintf(stderr, "UDPReceiverGroup: multiple receivers require the POSIX socket backend\n");
+        receiverCount = 1;
+    }
+#endif
+    if (receiverCount < 1)
+        receiverCount = 1;
+    params.reusePort = params.reusePort or (receiverCount > 1);
+    params.nonBlocking = false;
+    if (params.receiveTimeout <= 0)
+        params.receiveTimeout = 100;
+    for (int i = 0; i < receiverCount; i++) {
+        m_receivers.push_back(std::make_unique<Receiver>(ringCapacity));
+        if (not m_receivers.back()->m_socket.Open(localAddress, port, params)) {
+            m_receivers.clear();
+            return false;
+        }
+    }
+    m_isRunning = true;
+    for (int i = 0; i < receiverCount; i++)
+        m_receivers[i]->m_thread = std::thread(&UDPReceiverGroup::Run, this, i, handler);
+    return true;
+}
+
+
+void UDPReceiverGroup::Stop(void) {
+    m_isRunning = false;
+    for (auto& r : m_receivers)
+        if (r->m_thread.joinable())
+            r->m_thread.join();
+    for (auto& r : m_receivers)
+        r->m_socket.Close();
+    m_receivers.clear();
+}
+
+
+uint64_t UDPReceiverGroup::Received(void) const {
+    uint64_t received = 0;
+    for (auto& r : m_receivers)
+        received += r->m_received.load(std::memory_order_relaxed);
+    return received;
+}
+
+
+void UDPReceiverGroup::Run(int worker, tHandler handler) {
+    Receiver& r = *m_receivers[worker];
+    while (m_isRunning.load(std::memory_order_relaxed)) {
+        int n = r.m_socket.ReceiveBatch(r.m_ring);
+        if (n <= 0) {
+#if !USE_POSIX_SOCKETS
+            // SDL_net sockets can't block, so don't spin on an idle socket
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+            continue;
+        }
+        r.m_received.fetch_add(uint64_t(n), std::memory_order_relaxed);
+        r.m_batches.fetch_add(1, std::memory_order_relaxed);
+        handler(worker, r.m_ring);
+        r.m_ring.Clear();
+    }
+}
+
+// =================================================================================================